@@ -0,0 +1,125 @@
+/**
+ * @file bench.hh
+ *
+ * A small harness for the benchmarks in this directory.  Each case is a callable which
+ * performs a given number of iterations of the operation being measured; the harness
+ * finds an iteration count which runs for at least --min-time, runs it once to warm the
+ * caches and then --repetitions more times, and reports the median, min and max ns/op.
+ *
+ * usage: <bench> [--repetitions N] [--min-time MS] [--filter SUBSTRING]
+ */
+#ifndef __CONFIG_BENCH_HH_
+#define __CONFIG_BENCH_HH_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+namespace bench {
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// BARRIERS
+//////////////////////////////////////////////////////////////////////////////////////////
+/// forces value to be materialized, so the computation of it can not be elided
+template <typename _Tp>
+inline void
+do_not_optimize(const _Tp& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/// forces every pending write to memory to be performed
+inline void
+clobber_memory() {
+    asm volatile("" : : : "memory");
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// RUNNER
+//////////////////////////////////////////////////////////////////////////////////////////
+class runner {
+public:
+    runner(int argc, char* argv[])
+        : _M_repetitions(5), _M_min_ns(50 * 1000 * 1000)
+    {
+        for (int i = 1; i < argc; ++i) {
+            const bool has_value = i + 1 < argc;
+
+            if (has_value && 0 == strcmp(argv[i], "--repetitions")) {
+                _M_repetitions = std::max(1, atoi(argv[++i]));
+            } else if (has_value && 0 == strcmp(argv[i], "--min-time")) {
+                _M_min_ns = std::max(1L, atol(argv[++i])) * 1000 * 1000;
+            } else if (has_value && 0 == strcmp(argv[i], "--filter")) {
+                _M_filter = argv[++i];
+            } else {
+                fprintf(stderr, "usage: %s [--repetitions N] [--min-time MS]"
+                                " [--filter SUBSTRING]\n", argv[0]);
+                exit(2);
+            }
+        }
+
+        printf("%-44s %12s %10s %10s %10s\n", "benchmark", "iterations", "ns/op", "min"
+                                            , "max");
+    }
+
+    /// fn(n) performs n iterations
+    template <typename _Fn>
+    void
+    run(const std::string& name, _Fn fn) {
+        if (! _M_filter.empty() && std::string::npos == name.find(_M_filter))
+            return;
+
+        /* grow the count until a single run is long enough to time */
+        size_t iterations = 1;
+
+        for (;;) {
+            const double ns = _S_time(fn, iterations);
+
+            if (ns >= _M_min_ns || iterations >= (size_t(1) << 40))
+                break;
+
+            const double scale = (ns > 0) ? 1.4 * _M_min_ns / ns : 10;
+            iterations = static_cast<size_t>(iterations * std::min(10.0, scale)) + 1;
+        }
+
+        /* warmup */
+        _S_time(fn, iterations);
+
+        std::vector<double> per_op;
+
+        for (int i = 0; i < _M_repetitions; ++i)
+            per_op.push_back(_S_time(fn, iterations) / iterations);
+
+        std::sort(per_op.begin(), per_op.end());
+        printf("%-44s %12zu %10.2f %10.2f %10.2f\n", name.c_str(), iterations
+             , per_op[per_op.size() / 2], per_op.front(), per_op.back());
+        fflush(stdout);
+    }
+
+private:
+    template <typename _Fn>
+    static double
+    _S_time(_Fn& fn, size_t iterations) {
+        typedef std::chrono::steady_clock clock;
+
+        clobber_memory();
+        const clock::time_point begin = clock::now();
+        fn(iterations);
+        clobber_memory();
+        const clock::time_point end = clock::now();
+
+        return std::chrono::duration<double, std::nano>(end - begin).count();
+    }
+
+    int         _M_repetitions;
+    long        _M_min_ns;
+    std::string _M_filter;
+};
+
+} // ns bench
+
+#endif //__CONFIG_BENCH_HH_
@@ -0,0 +1,64 @@
+/**
+ * @file generate.cc
+ *
+ * Writes a synthetic config; @see bench::shape for the meaning of each option.
+ *
+ * usage: generate <dir> [--keys N] [--depth N] [--width N] [--vector-len N]
+ *                       [--string-len N] [--macros N] [--includes N]
+ */
+#include "generator.hh"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+
+static void
+usage(const char* argv0) {
+    std::cerr << "usage: " << argv0 << " <dir> [--keys N] [--depth N] [--width N]"
+                                       " [--vector-len N] [--string-len N] [--macros N]"
+                                       " [--includes N]" << std::endl;
+    exit(2);
+}
+
+int
+main(int argc, char* argv[]) {
+    static const struct { const char* name; size_t bench::shape::* field; } OPTIONS[] = {
+        { "--keys"      , &bench::shape::keys       },
+        { "--depth"     , &bench::shape::depth      },
+        { "--width"     , &bench::shape::width      },
+        { "--vector-len", &bench::shape::vector_len },
+        { "--string-len", &bench::shape::string_len },
+        { "--macros"    , &bench::shape::macros     },
+        { "--includes"  , &bench::shape::includes   },
+    };
+
+    if (argc < 2 || '-' == argv[1][0])
+        usage(argv[0]);
+
+    bench::shape s;
+
+    for (int i = 2; i < argc; i += 2) {
+        bool found = false;
+
+        for (size_t o = 0; o < sizeof(OPTIONS) / sizeof(*OPTIONS); ++o) {
+            if (i + 1 < argc && 0 == strcmp(argv[i], OPTIONS[o].name)) {
+                s.*OPTIONS[o].field = strtoul(argv[i + 1], 0x0, 10);
+                found = true;
+            }
+        }
+
+        if (! found)
+            usage(argv[0]);
+    }
+
+    try {
+        std::cout << bench::generate(s, argv[1]) << std::endl;
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
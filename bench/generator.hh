@@ -0,0 +1,143 @@
+/**
+ * @file generator.hh
+ *
+ * Writes synthetic configs whose shape is scaled along independent axes, for the parse
+ * benchmarks and for reproducing a slow load without the config which caused it.
+ */
+#ifndef __CONFIG_GENERATOR_HH_
+#define __CONFIG_GENERATOR_HH_
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace bench {
+
+/**
+ * @struct shape
+ *
+ * keys        scalar (and vector) values in total
+ * depth       sections each value is nested in below its top level section
+ * width       values per innermost section
+ * vector_len  elements of each vector; every fourth value is a vector when non-zero
+ * string_len  characters of each string value
+ * macros      @defines; when non-zero every eighth value reads one of them
+ * includes    files the top level sections are spread over, each @included by the root;
+ *             zero writes everything into the root
+ */
+struct shape {
+    shape()
+        : keys(10000), depth(1), width(16), vector_len(0), string_len(16), macros(0)
+        , includes(0)
+    {}
+
+    size_t keys;
+    size_t depth;
+    size_t width;
+    size_t vector_len;
+    size_t string_len;
+    size_t macros;
+    size_t includes;
+};
+
+/**
+ * Writes root.cfg (and inc_<n>.cfg for each include) into dir, which must exist.
+ *
+ * @return the path of root.cfg
+ * @throw std::runtime_error if a file can not be written
+ */
+inline std::string
+generate(const shape& s, const std::string& dir) {
+    const size_t width    = s.width ? s.width : 1;
+    const size_t sections = (s.keys + width - 1) / width;
+    const std::string text(s.string_len, 'x');
+
+    std::vector<std::stringstream> files(s.includes ? s.includes : 1);
+    std::stringstream root;
+
+    for (size_t m = 0; m < s.macros; ++m)
+        root << "@define M_" << m << " = \"" << m << "\"\n";
+
+    size_t key = 0;
+
+    for (size_t sec = 0; sec < sections; ++sec) {
+        std::stringstream& out = files[sec % files.size()];
+        out << "section_" << sec << " = {\n";
+
+        for (size_t d = 0; d < s.depth; ++d)
+            out << "nested_" << d << " = {\n";
+
+        for (size_t n = 0; n < width && key < s.keys; ++n, ++key) {
+            out << "    key_" << n << " = ";
+
+            if (s.macros && 0 == key % 8) {
+                out << "\"$M_" << (key / 8) % s.macros << "\"";
+            } else if (s.vector_len && 3 == key % 4) {
+                out << "[ 0";
+
+                for (size_t v = 1; v < s.vector_len; ++v)
+                    out << ", " << v;
+
+                out << " ]";
+            } else {
+                switch (key % 4) {
+                    case 0:  out << key;                break;
+                    case 1:  out << key << ".5";        break;
+                    case 2:  out << "\"" << text << "\""; break;
+                    default: out << "true";             break;
+                }
+            }
+
+            out << "\n";
+        }
+
+        for (size_t d = 0; d <= s.depth; ++d)
+            out << "}\n";
+    }
+
+    if (s.includes) {
+        for (size_t i = 0; i < files.size(); ++i) {
+            std::stringstream name;
+            name << "inc_" << i << ".cfg";
+
+            std::ofstream inc(dir + "/" + name.str(), std::ios::trunc);
+            inc << files[i].str();
+
+            if (! inc)
+                throw std::runtime_error("cannot write " + dir + "/" + name.str());
+
+            root << "@include \"$DOT/" << name.str() << "\"\n";
+        }
+    } else {
+        root << files[0].str();
+    }
+
+    const std::string path = dir + "/root.cfg";
+    std::ofstream out(path, std::ios::trunc);
+    out << root.str();
+
+    if (! out)
+        throw std::runtime_error("cannot write " + path);
+
+    return path;
+}
+
+/// removes what generate(s, dir) wrote
+inline void
+remove_generated(const shape& s, const std::string& dir) {
+    for (size_t i = 0; i < s.includes; ++i) {
+        std::stringstream name;
+        name << dir << "/inc_" << i << ".cfg";
+        std::remove(name.str().c_str());
+    }
+
+    std::remove((dir + "/root.cfg").c_str());
+}
+
+} // ns bench
+
+#endif //__CONFIG_GENERATOR_HH_
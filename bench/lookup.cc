@@ -0,0 +1,345 @@
+/**
+ * @file lookup.cc
+ *
+ * Cost of reading a loaded hierarchy: get<T> against sections of growing size, chains
+ * of section() calls, has_kwarg, get(key, default), vector iteration and the resolved
+ * forms (get_path, config_key, span).  The plain struct reads which tst2.cc compared
+ * against are measured alongside as a floor.
+ *
+ * The config is generated into $TMPDIR and removed once loaded.
+ */
+#include "config.hh"
+#include "bench.hh"
+
+#include <unistd.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+using namespace std;
+using bench::do_not_optimize;
+
+static const size_t SIZES[]  = { 4, 16, 64, 256, 1024 };
+static const size_t DEPTHS[] = { 1, 2, 4, 8 };
+static const size_t LENGTHS[] = { 16, 256 };
+
+static string
+key_name(size_t n) {
+    stringstream ss;
+    ss << "key_" << n;
+    return ss.str();
+}
+
+/// one section per size, one chain per depth and one vector per length
+static string
+generate() {
+    stringstream cfg;
+
+    for (size_t s = 0; s < sizeof(SIZES) / sizeof(*SIZES); ++s) {
+        cfg << "size_" << SIZES[s] << " = {\n";
+
+        for (size_t n = 0; n < SIZES[s]; ++n)
+            cfg << "    " << key_name(n) << " = " << n << "\n";
+
+        cfg << "}\n";
+    }
+
+    for (size_t d = 0; d < sizeof(DEPTHS) / sizeof(*DEPTHS); ++d) {
+        cfg << "depth_" << DEPTHS[d] << " = ";
+
+        for (size_t n = 0; n < DEPTHS[d]; ++n)
+            cfg << "{ next = ";
+
+        cfg << "{ value = 1 }";
+
+        for (size_t n = 0; n < DEPTHS[d]; ++n)
+            cfg << " }";
+
+        cfg << "\n";
+    }
+
+    for (size_t l = 0; l < sizeof(LENGTHS) / sizeof(*LENGTHS); ++l) {
+        cfg << "vector_" << LENGTHS[l] << " = [ 0";
+
+        for (size_t n = 1; n < LENGTHS[l]; ++n)
+            cfg << ", " << n;
+
+        cfg << " ]\n";
+    }
+
+    cfg << "typed = { integral = 1000 floating = 3.30 boolean = true"
+           " string = \"words\" }\n";
+
+    const char* tmpdir = getenv("TMPDIR");
+    string name = string(tmpdir ? tmpdir : "/tmp") + "/config-bench-XXXXXX";
+    vector<char> buffer(name.begin(), name.end());
+    buffer.push_back('\0');
+
+    const int fd = mkstemp(buffer.data());
+
+    if (fd < 0) {
+        perror("mkstemp");
+        exit(1);
+    }
+
+    close(fd);
+
+    ofstream out(buffer.data(), ios::trunc);
+    out << cfg.str();
+    return buffer.data();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+static void
+bench_get(bench::runner& run, const config& cfg) {
+    for (size_t s = 0; s < sizeof(SIZES) / sizeof(*SIZES); ++s) {
+        const size_t size = SIZES[s];
+        const config_section* sec = cfg.section("size_" + to_string(size));
+        vector<string> keys;
+
+        for (size_t n = 0; n < size; ++n)
+            keys.push_back(key_name(n));
+
+        /* every key of the section in turn; size is a power of two */
+        run.run("get<long>/size:" + to_string(size), [&](size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i)
+                do_not_optimize(sec->get<long>(keys[i & (size - 1)]));
+        });
+
+        /* the same keys interned up front; no hashing and no comparison of characters */
+        vector<kwarg_key> interned;
+
+        for (size_t n = 0; n < size; ++n)
+            interned.push_back(cfg.intern(keys[n]));
+
+        run.run("get<long>/interned/size:" + to_string(size), [&](size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i)
+                do_not_optimize(sec->get<long>(interned[i & (size - 1)]));
+        });
+    }
+
+    const config_section* typed = cfg.section("typed");
+
+    run.run("get<long>/typed", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i)
+            do_not_optimize(typed->get<long>("integral"));
+    });
+
+    run.run("get<double>/typed", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i)
+            do_not_optimize(typed->get<double>("floating"));
+    });
+
+    run.run("get<bool>/typed", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i)
+            do_not_optimize(typed->get<bool>("boolean"));
+    });
+
+    run.run("get<string>/typed", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i)
+            do_not_optimize(typed->get<string>("string"));
+    });
+
+    run.run("get<const char*>/typed", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i)
+            do_not_optimize(typed->get<const char*>("string"));
+    });
+}
+
+static void
+bench_section(bench::runner& run, const config& cfg) {
+    for (size_t d = 0; d < sizeof(DEPTHS) / sizeof(*DEPTHS); ++d) {
+        const size_t depth = DEPTHS[d];
+        const string root = "depth_" + to_string(depth);
+
+        run.run("section()/depth:" + to_string(depth), [&](size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                const config_section* sec = cfg.section(root);
+
+                for (size_t n = 0; n < depth; ++n)
+                    sec = sec->section("next");
+
+                do_not_optimize(sec->get<long>("value"));
+            }
+        });
+
+        string path = root;
+
+        for (size_t n = 0; n < depth; ++n)
+            path += ".next";
+
+        path += ".value";
+
+        run.run("get_path/depth:" + to_string(depth), [&](size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i)
+                do_not_optimize(cfg.get_path<long>(path));
+        });
+
+        const config_key<long> key = cfg.key<long>(path);
+
+        run.run("config_key/depth:" + to_string(depth), [&](size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i)
+                do_not_optimize(*key);
+        });
+    }
+}
+
+static void
+bench_has(bench::runner& run, const config& cfg) {
+    const config_section* sec = cfg.section("size_64");
+
+    run.run("has_kwarg/hit", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i)
+            do_not_optimize(sec->has_kwarg("key_42"));
+    });
+
+    run.run("has_kwarg/miss", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i)
+            do_not_optimize(sec->has_kwarg("no_such_key"));
+    });
+
+    run.run("get(key, default)/hit", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i)
+            do_not_optimize(sec->get<long>("key_42", -1));
+    });
+
+    run.run("get(key, default)/miss", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i)
+            do_not_optimize(sec->get<long>("no_such_key", -1));
+    });
+}
+
+/// ns/op is per element
+static void
+bench_vector(bench::runner& run, const config& cfg) {
+    for (size_t l = 0; l < sizeof(LENGTHS) / sizeof(*LENGTHS); ++l) {
+        const size_t length = LENGTHS[l];
+        const string name = "vector_" + to_string(length);
+        const kwarg_vector& vec = cfg.vector(name);
+
+        run.run("vector/iterate/length:" + to_string(length), [&](size_t iterations) {
+            for (size_t i = 0; i < iterations; i += length) {
+                int64_t sum = 0;
+
+                for (auto it = vec->cbegin(); it != vec->cend(); ++it)
+                    sum += (*it)->as<int64_t>();
+
+                do_not_optimize(sum);
+            }
+        });
+
+        run.run("vector/lookup+iterate/length:" + to_string(length)
+              , [&](size_t iterations) {
+            for (size_t i = 0; i < iterations; i += length) {
+                const kwarg_vector& each = cfg.vector(name);
+                int64_t sum = 0;
+
+                for (auto it = each->cbegin(); it != each->cend(); ++it)
+                    sum += (*it)->as<int64_t>();
+
+                do_not_optimize(sum);
+            }
+        });
+
+        const config_span<int64_t> span = vec.span<int64_t>();
+
+        run.run("vector/span/length:" + to_string(length), [&](size_t iterations) {
+            for (size_t i = 0; i < iterations; i += length) {
+                int64_t sum = 0;
+
+                for (auto it = span.begin(); it != span.end(); ++it)
+                    sum += *it;
+
+                do_not_optimize(sum);
+            }
+        });
+
+        vector<int64_t> plain;
+
+        for (size_t n = 0; n < length; ++n)
+            plain.push_back(n);
+
+        run.run("baseline/std::vector/length:" + to_string(length)
+              , [&](size_t iterations) {
+            for (size_t i = 0; i < iterations; i += length) {
+                int64_t sum = 0;
+
+                for (auto it = plain.begin(); it != plain.end(); ++it)
+                    sum += *it;
+
+                do_not_optimize(sum);
+            }
+        });
+    }
+}
+
+/// the hand written structure tst2.cc compared the hierarchy against
+static void
+bench_baseline(bench::runner& run) {
+    struct test {
+        int     integer_data;
+        string  string_data;
+        float   float_data;
+
+        test*   next;
+    };
+
+    unique_ptr<test> tail(new test());
+    tail->integer_data = 1000;
+    tail->float_data   = 3.30;
+    tail->string_data  = "words";
+    tail->next         = 0x0;
+
+    unique_ptr<test> middle(new test());
+    middle->next = tail.get();
+
+    unique_ptr<test> head(new test());
+    *head = *tail;
+    head->next = middle.get();
+
+    test* volatile root = head.get();
+
+    run.run("baseline/struct/depth:0", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i)
+            do_not_optimize(root->integer_data);
+    });
+
+    run.run("baseline/struct/depth:2", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i)
+            do_not_optimize(root->next->next->integer_data);
+    });
+
+    run.run("baseline/struct/string", [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) {
+            string copy = root->string_data;
+            do_not_optimize(copy);
+        }
+    });
+}
+
+int
+main(int argc, char* argv[]) {
+    bench::runner run(argc, argv);
+    const string path = generate();
+
+#if defined(CONFIG_SINGLETON)
+    const config* cfg = config::initialize(path);
+#else
+    unique_ptr<const config> cfg(new config(path));
+#endif
+    remove(path.c_str());
+
+    bench_get(run, *cfg);
+    bench_section(run, *cfg);
+    bench_has(run, *cfg);
+    bench_vector(run, *cfg);
+    bench_baseline(run);
+    return 0;
+}
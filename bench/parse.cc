@@ -0,0 +1,240 @@
+/**
+ * @file parse.cc
+ *
+ * How the cost of a load grows along each axis of bench::shape.  Every axis is swept in
+ * turn with the others held at the defaults of bench::shape; a cost per key which grows
+ * with an axis is a super-linear path in the parser.
+ *
+ * Each case is loaded in a child process so that its peak RSS is its own: the child loads
+ * the config once to warm up and then --repetitions more times and reports the median
+ * load time and the growth of its peak RSS over the loads.
+ *
+ * usage: parse [--repetitions N] [--axis NAME] [--flags mmap,arena,parallel,cache,lazy]
+ */
+#include "config.hh"
+#include "config-reload.hh"
+#include "bench.hh"
+#include "generator.hh"
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+using namespace std;
+
+struct axis {
+    const char*     name;
+    size_t bench::shape::* field;
+    vector<size_t>  values;
+};
+
+struct result {
+    double  median_ns;
+    long    rss_kb;     /*< growth of the peak over the loads >*/
+};
+
+static long
+peak_rss_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/// loads path in a child; false if the load failed
+static bool
+measure(const string& path, int flags, int repetitions, result& res) {
+    int fds[2];
+
+    if (0 != pipe(fds))
+        return false;
+
+    const pid_t pid = fork();
+
+    if (0 == pid) {
+        close(fds[0]);
+        result out;
+        const long before = peak_rss_kb();
+        vector<double> times;
+
+        try {
+            for (int i = 0; i <= repetitions; ++i) {
+                typedef chrono::steady_clock clock;
+                const clock::time_point begin = clock::now();
+
+                /* a handle so that repeated loads work with CONFIG_SINGLETON as well */
+                {
+                    config_handle handle(path, flags);
+                    bench::do_not_optimize(handle.acquire().get());
+                }
+
+                const clock::time_point end = clock::now();
+
+                if (i > 0)
+                    times.push_back(chrono::duration<double, nano>(end - begin).count());
+            }
+        } catch (const exception& e) {
+            fprintf(stderr, "%s: %s\n", path.c_str(), e.what());
+            _exit(1);
+        }
+
+        sort(times.begin(), times.end());
+        out.median_ns = times[times.size() / 2];
+        out.rss_kb    = peak_rss_kb() - before;
+
+        const bool sent = sizeof(out) == write(fds[1], &out, sizeof(out));
+        _exit(sent ? 0 : 1);
+    }
+
+    close(fds[1]);
+    const bool read_all = sizeof(res) == read(fds[0], &res, sizeof(res));
+    close(fds[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return read_all && WIFEXITED(status) && 0 == WEXITSTATUS(status);
+}
+
+static size_t
+file_bytes(const bench::shape& s, const string& dir) {
+    struct stat info;
+    size_t bytes = 0;
+
+    if (0 == stat((dir + "/root.cfg").c_str(), &info))
+        bytes += info.st_size;
+
+    for (size_t i = 0; i < s.includes; ++i) {
+        const string inc = dir + "/inc_" + to_string(i) + ".cfg";
+
+        if (0 == stat(inc.c_str(), &info))
+            bytes += info.st_size;
+    }
+
+    return bytes;
+}
+
+static int
+parse_flags(const char* names) {
+    static const struct { const char* name; int flag; } FLAGS[] = {
+        { "mmap"    , config::LOAD_MMAP           },
+        { "arena"   , config::LOAD_ARENA          },
+        { "parallel", config::LOAD_PARALLEL       },
+        { "cache"   , config::LOAD_CACHE_INCLUDES },
+        { "lazy"    , config::LOAD_LAZY           },
+    };
+
+    int flags = config::LOAD_DEFAULT;
+    string list(names);
+    size_t pos = 0;
+
+    while (pos <= list.size()) {
+        const size_t comma = min(list.find(',', pos), list.size());
+        const string name = list.substr(pos, comma - pos);
+        bool found = false;
+
+        for (size_t i = 0; i < sizeof(FLAGS) / sizeof(*FLAGS); ++i) {
+            if (name == FLAGS[i].name) {
+                flags |= FLAGS[i].flag;
+                found = true;
+            }
+        }
+
+        if (! found && ! name.empty()) {
+            fprintf(stderr, "unknown flag: %s\n", name.c_str());
+            exit(2);
+        }
+
+        pos = comma + 1;
+    }
+
+    return flags;
+}
+
+int
+main(int argc, char* argv[]) {
+    int repetitions = 5;
+    int flags = config::LOAD_DEFAULT;
+    string only;
+
+    for (int i = 1; i < argc; ++i) {
+        const bool has_value = i + 1 < argc;
+
+        if (has_value && 0 == strcmp(argv[i], "--repetitions")) {
+            repetitions = max(1, atoi(argv[++i]));
+        } else if (has_value && 0 == strcmp(argv[i], "--axis")) {
+            only = argv[++i];
+        } else if (has_value && 0 == strcmp(argv[i], "--flags")) {
+            flags = parse_flags(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--repetitions N] [--axis NAME]"
+                            " [--flags mmap,arena,parallel,cache,lazy]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const axis AXES[] = {
+        { "keys"      , &bench::shape::keys      , { 1000, 10000, 50000, 200000 } },
+        { "depth"     , &bench::shape::depth     , { 1, 4, 16, 64 }               },
+        { "width"     , &bench::shape::width     , { 4, 64, 1024, 8192 }          },
+        { "vector_len", &bench::shape::vector_len, { 4, 64, 512 }                 },
+        { "string_len", &bench::shape::string_len, { 8, 64, 512, 4096 }           },
+        { "macros"    , &bench::shape::macros    , { 16, 256, 4096 }              },
+        { "includes"  , &bench::shape::includes  , { 4, 64, 512 }                 },
+    };
+
+    const char* tmpdir = getenv("TMPDIR");
+    string name = string(tmpdir ? tmpdir : "/tmp") + "/config-parse-XXXXXX";
+    vector<char> buffer(name.begin(), name.end());
+    buffer.push_back('\0');
+
+    if (0x0 == mkdtemp(buffer.data())) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    const string dir(buffer.data());
+    int failures = 0;
+
+    printf("%-12s %8s %10s %12s %10s %10s %10s\n", "axis", "value", "MB", "parse ms"
+                                                , "MB/s", "ns/key", "peak RSS");
+
+    for (size_t a = 0; a < sizeof(AXES) / sizeof(*AXES); ++a) {
+        const axis& ax = AXES[a];
+
+        if (! only.empty() && only != ax.name)
+            continue;
+
+        for (size_t v = 0; v < ax.values.size(); ++v) {
+            bench::shape s;
+            s.*ax.field = ax.values[v];
+
+            const string path  = bench::generate(s, dir);
+            const double bytes = file_bytes(s, dir);
+            result res;
+
+            if (measure(path, flags, repetitions, res)) {
+                const double mb = bytes / (1024 * 1024);
+                printf("%-12s %8zu %10.2f %12.3f %10.1f %10.1f %8.1fMB\n", ax.name
+                     , ax.values[v], mb, res.median_ns / 1e6, mb / (res.median_ns / 1e9)
+                     , res.median_ns / s.keys, res.rss_kb / 1024.0);
+            } else {
+                printf("%-12s %8zu %10s\n", ax.name, ax.values[v], "FAILED");
+                ++failures;
+            }
+
+            fflush(stdout);
+            bench::remove_generated(s, dir);
+        }
+    }
+
+    rmdir(dir.c_str());
+    return failures ? 1 : 0;
+}
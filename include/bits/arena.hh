@@ -0,0 +1,253 @@
+/**
+ * @file bits/arena.hh
+ *
+ * Monotonic allocation used by config::LOAD_ARENA.  A config_arena hands out memory from
+ * a small number of large blocks and never frees individual allocations; everything is
+ * released at once when the arena itself is destroyed.
+ */
+#ifndef __BITS_ARENA_HH_
+#define __BITS_ARENA_HH_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @class config_arena
+ *
+ * Not thread safe; a single arena is only ever touched by the thread parsing into it.
+ * Worker threads (config::LOAD_PARALLEL) each fill their own arena which is adopted by
+ * the config's arena once their subtree is spliced in.
+ *
+ * @complexity allocate O(1), destruction O(blocks)
+ */
+class config_arena {
+public:
+    explicit config_arena(std::size_t block_size = 64 * 1024)
+        : _M_head(0x0), _M_cur(0x0), _M_end(0x0), _M_block_size(block_size)
+        , _M_reserved(0), _M_parent(0x0), _M_adopted(0x0), _M_sibling(0x0)
+        , _M_releases(0x0)
+    {}
+
+    ~config_arena() {
+        for (release* rel = _M_releases.load(std::memory_order_acquire); rel; ) {
+            release* next = rel->next;
+            rel->fn(rel->ptr);
+            delete rel;
+            rel = next;
+        }
+
+        while (_M_head) {
+            block* next = _M_head->next;
+            ::operator delete(_M_head);
+            _M_head = next;
+        }
+
+        while (_M_adopted) {
+            config_arena* next = _M_adopted->_M_sibling;
+            delete _M_adopted;
+            _M_adopted = next;
+        }
+    }
+
+    void*
+    allocate(std::size_t size, std::size_t align = alignof(std::max_align_t)) {
+        if (_M_parent)
+            return _M_parent->allocate(size, align);
+
+        char* ptr = _S_align(_M_cur, align);
+
+        if (0x0 == _M_cur || ptr + size > _M_end) {
+            _M_grow(size + align);
+            ptr = _S_align(_M_cur, align);
+        }
+
+        _M_cur = ptr + size;
+        return ptr;
+    }
+
+    /**
+     * Takes ownership of other and every block it has handed out, which stay valid for
+     * the lifetime of this arena.  Containers built against other (eg: the index of a
+     * section parsed on a worker) keep a pointer to it, so other lives on and forwards
+     * any further allocation here.
+     */
+    void
+    adopt(std::unique_ptr<config_arena> other) {
+        config_arena* child = other.release();
+
+        if (child->_M_head) {
+            block* tail = child->_M_head;
+
+            while (tail->next)
+                tail = tail->next;
+
+            /* the chain is only walked on destruction so the current block need not
+             * lead */
+            tail->next   = _M_head;
+            _M_head      = child->_M_head;
+            _M_reserved += child->_M_reserved;
+        }
+
+        child->_M_head     = 0x0;
+        child->_M_cur      = 0x0;
+        child->_M_end      = 0x0;
+        child->_M_reserved = 0;
+        child->_M_parent   = this;
+        child->_M_sibling  = _M_adopted;
+        _M_adopted         = child;
+    }
+
+    /**
+     * Keeps other alive for at least the lifetime of this arena, for nodes allocated in
+     * this arena which refer to nodes in other (eg: an include shared out of the cache of
+     * a config_handle, which outlives the config that first parsed it).
+     */
+    void
+    retain(const std::shared_ptr<config_arena>& other) {
+        if (std::find(_M_retained.begin(), _M_retained.end(), other) == _M_retained.end())
+            _M_retained.push_back(other);
+    }
+
+    /**
+     * Calls fn(ptr) when the arena is destroyed, for memory built after the load which
+     * nodes in the arena refer to (eg: the element nodes of a packed vector, built when
+     * first read).  Unlike allocate(...) it may be called from any thread.
+     */
+    void
+    at_release(void (*fn)(void*), void* ptr) {
+        release* rel = new release;
+        rel->fn   = fn;
+        rel->ptr  = ptr;
+        rel->next = _M_releases.load(std::memory_order_relaxed);
+
+        while (! _M_releases.compare_exchange_weak(rel->next, rel
+                                                 , std::memory_order_release
+                                                 , std::memory_order_relaxed))
+            ;
+    }
+
+    /// bytes requested from the system allocator
+    std::size_t reserved() const
+    { return _M_reserved; }
+
+    config_arena(const config_arena&) = delete;
+    config_arena& operator=(const config_arena&) = delete;
+
+private:
+    struct block {
+        block*      next;
+        std::size_t size;
+    };
+
+    struct release {
+        void      (*fn)(void*);
+        void*       ptr;
+        release*    next;
+    };
+
+    static char*
+    _S_align(char* ptr, std::size_t align) {
+        const std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(ptr);
+        return reinterpret_cast<char*>((addr + align - 1) & ~(align - 1));
+    }
+
+    void
+    _M_grow(std::size_t min_size) {
+        /* blocks double up to 1MiB so that small configs stay small and large configs
+         * land in a handful of allocations */
+        std::size_t size = _M_block_size;
+
+        if (_M_block_size < (1 << 20))
+            _M_block_size *= 2;
+
+        if (size < min_size + sizeof(block))
+            size = min_size + sizeof(block);
+
+        block* blk = static_cast<block*>(::operator new(size));
+        blk->next  = _M_head;
+        blk->size  = size;
+        _M_head    = blk;
+        _M_cur     = reinterpret_cast<char*>(blk + 1);
+        _M_end     = reinterpret_cast<char*>(blk) + size;
+        _M_reserved += size;
+    }
+
+    block*      _M_head;
+    char*       _M_cur;
+    char*       _M_end;
+    std::size_t _M_block_size;
+    std::size_t _M_reserved;
+
+    config_arena* _M_parent;    /*< set once adopted >*/
+    config_arena* _M_adopted;   /*< first adopted arena, linked through _M_sibling >*/
+    config_arena* _M_sibling;
+
+    std::vector<std::shared_ptr<config_arena>> _M_retained;
+    std::atomic<release*> _M_releases;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @class arena_allocator
+ *
+ * Standard allocator adaptor over a config_arena.  A default constructed (null) allocator
+ * forwards to the global operator new/delete so containers behave exactly as they would
+ * with std::allocator when no arena is in use.
+ */
+template <typename _Tp>
+class arena_allocator {
+public:
+    typedef _Tp value_type;
+
+    arena_allocator(config_arena* arena = 0x0) noexcept
+        : _M_arena(arena)
+    {}
+
+    template <typename _Up>
+    arena_allocator(const arena_allocator<_Up>& other) noexcept
+        : _M_arena(other.arena())
+    {}
+
+    _Tp*
+    allocate(std::size_t n) {
+        if (_M_arena)
+            return static_cast<_Tp*>(_M_arena->allocate(n * sizeof(_Tp), alignof(_Tp)));
+        else
+            return static_cast<_Tp*>(::operator new(n * sizeof(_Tp)));
+    }
+
+    void
+    deallocate(_Tp* ptr, std::size_t) noexcept {
+        if (0x0 == _M_arena)
+            ::operator delete(ptr);
+    }
+
+    config_arena* arena() const noexcept
+    { return _M_arena; }
+
+private:
+    config_arena* _M_arena;
+};
+
+template <typename _Tp, typename _Up>
+inline bool
+operator==(const arena_allocator<_Tp>& lhs, const arena_allocator<_Up>& rhs) {
+    return lhs.arena() == rhs.arena();
+}
+
+template <typename _Tp, typename _Up>
+inline bool
+operator!=(const arena_allocator<_Tp>& lhs, const arena_allocator<_Up>& rhs) {
+    return lhs.arena() != rhs.arena();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //__BITS_ARENA_HH_
@@ -0,0 +1,177 @@
+/**
+ * @file bits/symbols.hh
+ *
+ * Interned key names.  Every node of a config refers to its name through a symbol of the
+ * config's symbol_table, so each distinct name is stored once however many sections (and
+ * vector elements) use it.
+ */
+#ifndef __BITS_SYMBOLS_HH_
+#define __BITS_SYMBOLS_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "arena.hh"
+#include "config-bits.hh"
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @struct config_symbol
+ *
+ * A name interned by a symbol_table.  The characters, NUL terminated, are stored directly
+ * after the symbol, so a key can find its symbol from its characters alone.  .hash is the
+ * hash the config_section index files the name under, so neither a lookup by symbol nor a
+ * rehash touches the characters.  Two names interned by one table are equal if and only
+ * if their symbols are the same object.
+ */
+struct config_symbol {
+    uint32_t size;
+    uint32_t hash;
+
+    const char* data() const
+    { return reinterpret_cast<const char*>(this + 1); }
+};
+
+/**
+ * @struct static_symbol
+ *
+ * A config_symbol with its characters, for the names which are not interned.
+ */
+struct static_symbol {
+    config_symbol symbol;
+    char          chars[8];
+};
+
+///{@
+/// the names of nodes which are not the child of any section
+extern const static_symbol ROOT_SYMBOL;
+extern const static_symbol ANONYMOUS_SYMBOL;
+///@}
+
+/**
+ * @class symbol_table
+ *
+ * The names of one config, shared with any config_handle reload which reuses parts of
+ * it (config::LOAD_CACHE_INCLUDES).  Symbols are never removed and live as long as the
+ * table.  Interning locks, as workers (LOAD_PARALLEL) and readers building a lazy section
+ * (LOAD_LAZY) intern concurrently.
+ *
+ * @complexity intern O(size of the name)
+ */
+class symbol_table {
+public:
+    symbol_table()
+        : _M_arena(16 * 1024), _M_slots(64, 0x0), _M_size(0), _M_bytes(0)
+    {}
+
+    ///{@
+    /**
+     * intern(...) returns the symbol of a name, adding it if it is new; find(...) returns
+     * 0x0 if no name with those characters was ever interned.
+     */
+    const config_symbol*
+    intern(const char* data, std::size_t size) {
+        const uint32_t hash = kwarg_hash(data, size);
+        std::lock_guard<std::mutex> lock(_M_lock);
+
+        const config_symbol*& slot = _M_slot(data, size, hash);
+
+        if (slot)
+            return slot;
+
+        config_symbol* symbol = static_cast<config_symbol*>(
+                _M_arena.allocate(sizeof(config_symbol) + size + 1
+                                , alignof(config_symbol)));
+        symbol->size = static_cast<uint32_t>(size);
+        symbol->hash = hash;
+
+        char* chars = const_cast<char*>(symbol->data());
+        memcpy(chars, data, size);
+        chars[size] = '\0';
+
+        slot = symbol;
+        _M_bytes += sizeof(config_symbol) + size + 1;
+
+        /* keep the load factor at or below 1/2 */
+        if (2 * ++_M_size > _M_slots.size())
+            _M_rehash();
+
+        return symbol;
+    }
+
+    const config_symbol*
+    find(const char* data, std::size_t size) const {
+        const uint32_t hash = kwarg_hash(data, size);
+        std::lock_guard<std::mutex> lock(_M_lock);
+        return const_cast<symbol_table*>(this)->_M_slot(data, size, hash);
+    }
+    ///@}
+
+    ///{@
+    /// distinct names, and the bytes their characters and symbols take
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(_M_lock);
+        return _M_size;
+    }
+
+    std::size_t bytes() const {
+        std::lock_guard<std::mutex> lock(_M_lock);
+        return _M_bytes;
+    }
+    ///@}
+
+    symbol_table(const symbol_table&) = delete;
+    symbol_table& operator=(const symbol_table&) = delete;
+
+private:
+    /// the slot holding the name, or the empty slot it would be placed in
+    const config_symbol*&
+    _M_slot(const char* data, std::size_t size, uint32_t hash) {
+        const std::size_t mask = _M_slots.size() - 1;
+        std::size_t i = hash & mask;
+
+        for (; _M_slots[i]; i = (i + 1) & mask) {
+            const config_symbol* symbol = _M_slots[i];
+
+            if (symbol->hash == hash && symbol->size == size
+             && 0 == memcmp(symbol->data(), data, size))
+                break;
+        }
+
+        return _M_slots[i];
+    }
+
+    void
+    _M_rehash() {
+        std::vector<const config_symbol*> slots(2 * _M_slots.size(), 0x0);
+        const std::size_t mask = slots.size() - 1;
+
+        for (auto it = _M_slots.begin(); it != _M_slots.end(); ++it) {
+            if (0x0 == *it)
+                continue;
+
+            std::size_t i = (*it)->hash & mask;
+
+            while (slots[i])
+                i = (i + 1) & mask;
+
+            slots[i] = *it;
+        }
+
+        _M_slots.swap(slots);
+    }
+
+    mutable std::mutex _M_lock;
+    config_arena _M_arena;
+    std::vector<const config_symbol*> _M_slots;
+    std::size_t _M_size;
+    std::size_t _M_bytes;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //__BITS_SYMBOLS_HH_
@@ -8,19 +8,128 @@
 #define __BITS_CONFIG_HH_
 
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <array>
+#include <deque>
 #include <initializer_list>
-#include <map>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
+#include <unordered_set>
 #include <utility>
-
+#include <vector>
+
+class config_arena;
+class config_handler;
+class config_trace;
+struct config_source;
+class include_cache;
+class include_loader;
+class kwarg;
+struct lazy_body;
+class lazy_loader;
+struct parse_stats;
+struct include_record;
+class symbol_table;
 
 //////////////////////////////////////////////////////////////////////////////////////////
-/// TODO: encapsulate this internal iterator type info better
-typedef std::string::iterator _Iter;
+/**
+ * @class parse_iterator
+ *
+ * A bounded cursor over a read-only character buffer.  Dereferencing any position outside
+ * of [begin, end) yields '\0', which preserves the sentinel the lexer is written against
+ * without requiring the underlying buffer to be NUL terminated (eg: an mmap'd file).
+ */
+class parse_iterator {
+public:
+    parse_iterator()
+        : _M_pos(0x0), _M_begin(0x0), _M_end(0x0)
+    {}
+
+    parse_iterator(const char* begin, const char* end)
+        : _M_pos(begin), _M_begin(begin), _M_end(end)
+    {}
+
+    char
+    operator*() const {
+        return (_M_pos < _M_end && _M_pos >= _M_begin) ? *_M_pos : '\0';
+    }
+
+    ///{@
+    parse_iterator& operator++() { ++_M_pos; return *this; }
+    parse_iterator& operator--() { --_M_pos; return *this; }
+
+    parse_iterator
+    operator++(int) {
+        parse_iterator tmp(*this);
+        ++_M_pos;
+        return tmp;
+    }
+
+    parse_iterator
+    operator+(std::ptrdiff_t n) const {
+        parse_iterator tmp(*this);
+        tmp._M_pos += n;
+        return tmp;
+    }
+
+    parse_iterator
+    operator-(std::ptrdiff_t n) const {
+        parse_iterator tmp(*this);
+        tmp._M_pos -= n;
+        return tmp;
+    }
+
+    std::ptrdiff_t
+    operator-(const parse_iterator& rhs) const
+    { return _M_pos - rhs._M_pos; }
+
+    bool operator==(const parse_iterator& rhs) const { return _M_pos == rhs._M_pos; }
+    bool operator!=(const parse_iterator& rhs) const { return _M_pos != rhs._M_pos; }
+    ///@}
+
+    /// repositions the cursor within the same buffer
+    void seek(const char* pos)
+    { _M_pos = pos; }
+
+    ///{@
+    const char* base()  const { return _M_pos;   }
+    const char* begin() const { return _M_begin; }
+    const char* end()   const { return _M_end;   }
+    ///@}
+
+    /**
+     * Returns up to lsize characters before and rsize characters after the cursor,
+     * clamped to the underlying buffer.  Used to give parse errors some locality.
+     */
+    std::string
+    context(std::size_t lsize, std::size_t rsize) const {
+        const char* lhs = _M_pos;
+        const char* rhs = _M_pos;
+
+        if (lhs > _M_end)
+            lhs = rhs = _M_end;
+        else if (lhs < _M_begin)
+            lhs = rhs = _M_begin;
+
+        while (lsize-- && lhs > _M_begin)
+            --lhs;
+
+        while (rsize-- && rhs < _M_end)
+            ++rhs;
+
+        return std::string(lhs, rhs);
+    }
+
+private:
+    const char* _M_pos;
+    const char* _M_begin;
+    const char* _M_end;
+};
+
+typedef parse_iterator _Iter;
 
 inline bool
 acceptable_char(char c) {
@@ -30,6 +139,22 @@ acceptable_char(char c) {
         || c == '*';
 }
 
+/**
+ * FNV-1a over a key name.  Used by the config_section index; cheap for the short names
+ * which make up nearly every config.
+ */
+inline uint32_t
+kwarg_hash(const char* data, std::size_t size) {
+    uint32_t hash = 2166136261u;
+
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 
 class trie_lookup_error : public std::runtime_error {
@@ -51,74 +176,210 @@ public:
  * @class       parse_trie
  * @template    _ValType "stored type"
  *
- * This class is a non-compact trie structure which should not be used for high
- * performance access.
+ * A compact radix trie.  Every node lives in a single contiguous pool and refers to its
+ * (path compressed) edge label by offset into a shared label buffer, so a define never
+ * performs more than a few amortized appends and a lookup touches one node per edge
+ * rather than one heap allocated node per character.
+ *
+ * Keys are case insensitive.  lookup(...) returns the value of the longest defined
+ * prefix by reference; values are held in a deque so references remain valid across
+ * subsequent defines.
  *
  * @complexity O(len(key_name))
  */
 template <typename _ValType>
 class parse_trie {
 public:
-    parse_trie() = default;
-    parse_trie(std::initializer_list<std::pair<std::string, _ValType>> init) {
+    parse_trie()
+        : _M_nodes(1, node())
+    {}
+
+    parse_trie(std::initializer_list<std::pair<std::string, _ValType>> init)
+        : _M_nodes(1, node())
+    {
         for (auto it = init.begin(); it != init.end(); ++it)
             this->defval(it->first) = it->second;
     }
 
-    ~parse_trie() {
-        for (auto it = _M_paths.begin(); it != _M_paths.end(); ++it)
-            delete it->second;
-    }
-
     _ValType&
-    defval(std::string key) {
-        auto it = key.begin();
-        return this->define(it);
+    defval(const std::string& key) {
+        for (auto it = key.begin(); it != key.end(); ++it)
+            if (! acceptable_char(*it))
+                throw trie_define_error();
+
+        return _M_insert(key.data(), key.size());
     }
 
     template <typename _Iter>
     _ValType&
     define(_Iter& iter) {
-        const char index = _S_index_char(*iter);
+        std::string key;
 
-        if (! acceptable_char(*iter)) {
-            if ('\0' == *iter)
-                return _M_data;
-            else
-                throw trie_define_error();
-        }
+        while (acceptable_char(*iter))
+            key.append(1, *(iter++));
 
-        parse_trie* ptr(0x0);
-        auto it = _M_paths.find(index);
+        if ('\0' != *iter)
+            throw trie_define_error();
 
-        if (it == _M_paths.end())
-            _M_paths[index] = ptr = new parse_trie();
-        else
-            ptr = it->second;
-
-        return ptr->define(++iter);
+        return _M_insert(key.data(), key.size());
     }
 
+    /**
+     * Advances iter past the longest defined prefix (optionally preceded by a '{') and
+     * returns its value.
+     *
+     * @throw trie_lookup_error if no prefix of iter is defined
+     */
     template <typename _Iter>
-    _ValType
-    lookup(_Iter& iter) {
-        auto it = _M_lookup(iter);
+    const _ValType&
+    lookup(_Iter& iter) const {
+        if ('{' == *iter)
+            ++iter;
 
-        if (! it.first)
+        const _ValType* found = _M_terminal(0);
+        _Iter cursor = iter;
+        _Iter match  = iter;
+        uint32_t n   = 0;
+
+        while (acceptable_char(*cursor)) {
+            const uint32_t c = _M_child(n, _S_index_char(*cursor));
+
+            if (0 == c)
+                break;
+
+            const char* label = &_M_labels[_M_nodes[c].label];
+            uint32_t k = 0;
+
+            while (k < _M_nodes[c].length && label[k] == _S_index_char(*cursor)) {
+                ++cursor;
+                ++k;
+            }
+
+            /* a partially matched edge can never hold a value */
+            if (k < _M_nodes[c].length)
+                break;
+
+            n = c;
+
+            if (const _ValType* value = _M_terminal(n)) {
+                found = value;
+                match = cursor;
+            }
+        }
+
+        if (0x0 == found)
             throw trie_lookup_error();
-        else
-            return it.second;
+
+        iter = match;
+        return *found;
     }
 
 private:
-    static int
-    _S_index_char(char c) { return std::toupper(c); }
+    /**
+     * .child/.sibling are indices into _M_nodes; as the root (0) is never anybody's child
+     * or sibling, 0 doubles as the null index.  .value is 1 + the index into _M_values.
+     */
+    struct node {
+        node()
+            : label(0), length(0), child(0), sibling(0), value(0)
+        {}
+
+        uint32_t label;
+        uint32_t length;
+        uint32_t child;
+        uint32_t sibling;
+        uint32_t value;
+    };
+
+    static char
+    _S_index_char(char c) { return static_cast<char>(std::toupper(c)); }
+
+    uint32_t
+    _M_child(uint32_t n, char c) const {
+        uint32_t child = _M_nodes[n].child;
+
+        while (0 != child && _M_labels[_M_nodes[child].label] != c)
+            child = _M_nodes[child].sibling;
+
+        return child;
+    }
+
+    uint32_t
+    _M_new_node(uint32_t label, uint32_t length) {
+        _M_nodes.push_back(node());
+        _M_nodes.back().label  = label;
+        _M_nodes.back().length = length;
+        return static_cast<uint32_t>(_M_nodes.size() - 1);
+    }
+
+    _ValType&
+    _M_insert(const char* key, std::size_t size) {
+        uint32_t n = 0;
+        std::size_t pos = 0;
+
+        while (pos < size) {
+            const uint32_t c = _M_child(n, _S_index_char(key[pos]));
+
+            if (0 == c) {
+                /* remainder of the key becomes a single new edge */
+                const uint32_t label = static_cast<uint32_t>(_M_labels.size());
+
+                for (std::size_t i = pos; i < size; ++i)
+                    _M_labels.append(1, _S_index_char(key[i]));
+
+                const uint32_t leaf = _M_new_node(label, static_cast<uint32_t>(size - pos));
+                _M_nodes[leaf].sibling = _M_nodes[n].child;
+                _M_nodes[n].child = leaf;
+
+                n   = leaf;
+                pos = size;
+                break;
+            }
+
+            uint32_t k = 1;
+
+            while (k < _M_nodes[c].length && pos + k < size
+                && _M_labels[_M_nodes[c].label + k] == _S_index_char(key[pos + k]))
+                ++k;
+
+            if (k < _M_nodes[c].length) {
+                /* split the edge; the tail keeps the children and value */
+                const uint32_t tail = _M_new_node(_M_nodes[c].label + k
+                                                , _M_nodes[c].length - k);
+                _M_nodes[tail].child = _M_nodes[c].child;
+                _M_nodes[tail].value = _M_nodes[c].value;
+                _M_nodes[c].length = k;
+                _M_nodes[c].child  = tail;
+                _M_nodes[c].value  = 0;
+            }
+
+            n    = c;
+            pos += k;
+        }
+
+        if (0 == _M_nodes[n].value) {
+            _M_values.push_back(_ValType());
+            _M_nodes[n].value = static_cast<uint32_t>(_M_values.size());
+        }
+
+        return _M_values[_M_nodes[n].value - 1];
+    }
+
+    const _ValType*
+    _M_terminal(uint32_t n) const {
+        const uint32_t value = _M_nodes[n].value;
+
+        if (0 != value && _S_is_terminal(_M_values[value - 1]))
+            return &_M_values[value - 1];
+        else
+            return 0x0;
+    }
 
     //----------------------------------------------------------------------------------//
     ///{@
     /**
      * HACK:
-     * This struct template is used to for the two _M_is_terminal functions below to
+     * This struct template is used to for the two _S_is_terminal functions below to
      * allow for two _ValType's :
      *     o those with a .size() member
      *     o those which are castable with bool()
@@ -141,64 +402,85 @@ private:
         static constexpr bool value = sizeof(impl(static_cast<_K*>(0x0))) == sizeof(y);
     };
 
-    template <typename _Tp = _ValType>
-    typename std::enable_if<has_size_method<_Tp>::value, bool>::type
-    _M_is_terminal() const {
-        return 0 != _M_data.size();
+    template <typename _Tp>
+    static typename std::enable_if<has_size_method<_Tp>::value, bool>::type
+    _S_is_terminal(const _Tp& data) {
+        return 0 != data.size();
     }
 
-    template <typename _Tp = _ValType>
-    typename std::enable_if<!has_size_method<_Tp>::value, bool>::type
-    _M_is_terminal() const {
-        return static_cast<bool>(_M_data);
+    template <typename _Tp>
+    static typename std::enable_if<!has_size_method<_Tp>::value, bool>::type
+    _S_is_terminal(const _Tp& data) {
+        return static_cast<bool>(data);
     }
     ///@}
     //----------------------------------------------------------------------------------//
 
+    std::vector<node>    _M_nodes;
+    std::string          _M_labels;
+    std::deque<_ValType> _M_values;
+};
 
-    template <typename _Iter>
-    std::pair<bool, _ValType>
-    _M_lookup(_Iter& iter) {
-        const char index = _S_index_char(*iter);
-
-        switch (*iter) {
-            case '{':
-                return _M_lookup(++iter);
-
-            case '\0':
-            case ' ' :
-            case '\t':
-            case '\n':
-            case '\r':
-            case '}':
-                if (_M_is_terminal())
-                    return std::make_pair(true, _M_data);
-                else
-                    return std::make_pair(false, _M_data);
-
-            default:
-                break;
-        }
+//////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @struct parse_context
+ *
+ * State which is threaded through every level of a single parse; the macro registers,
+ * the load flags the root config was constructed with and the arena (if any) nodes are
+ * allocated from.
+ *
+ * With config::LOAD_PARALLEL .includes queues @include targets onto worker threads and
+ * .regs_version counts every change to the registers so that speculative work can be
+ * checked against them.  A worker parsing a detached include records in .replacing every
+ * section it created over a non-section value; those replace rather than merge with an
+ * existing section when the include is spliced.
+ *
+ * With config::LOAD_CACHE_INCLUDES .cache holds the parse of every file included so far
+ * and .record, while an include is being parsed for the cache, collects each file read,
+ * macro looked up and macro defined along the way.
+ *
+ * .sources collects every file read, or looked for, on behalf of config::sources.
+ *
+ * With config::LOAD_LAZY .lazy defers the body of each section which can be parsed later
+ * against a copy of the registers.
+ *
+ * .stats, if set, is charged with the work done; .stats_file is the index of the file
+ * being parsed in .stats->files (NO_FILE outside of any).
+ *
+ * .trace, if set, is written a span for each phase of the parse.
+ *
+ * .symbols interns the name of every node created; it is the table of the root config.
+ */
+struct parse_context {
+    parse_context(parse_trie<std::string>* regs, int flags, config_arena* arena = 0x0)
+        : regs(regs), flags(flags), arena(arena), includes(0x0), regs_version(0)
+        , replacing(0x0), cache(0x0), record(0x0), sources(0x0), lazy(0x0), stats(0x0)
+        , stats_file(NO_FILE), trace(0x0), symbols(0x0)
+    {}
 
-        auto lookupv = _M_paths.find(index);
+    static const std::size_t NO_FILE = static_cast<std::size_t>(-1);
 
-        if (lookupv == _M_paths.end())
-            return std::make_pair(_M_is_terminal(), _M_data);
+    parse_trie<std::string>* regs;
+    const int flags;
+    config_arena* arena;
 
-        auto it = _M_paths[index]->_M_lookup(++iter);
+    include_loader* includes;
+    std::size_t regs_version;
+    std::unordered_set<const kwarg*>* replacing;
 
-        if (it.first) {
-            /* somewhere down the line a match was found */
-            return it;
-        } else {
-            /* there was no match for the next character */
-            --iter;
-            return std::make_pair(_M_is_terminal(), _M_data);
-        }
-    }
+    include_cache* cache;
+    include_record* record;
+
+    std::vector<config_source>* sources;
+
+    lazy_loader* lazy;
+
+    parse_stats* stats;
+    std::size_t stats_file;
+
+    config_trace* trace;
 
-    _ValType _M_data;
-    std::map<char, parse_trie*> _M_paths;
+    symbol_table* symbols;
 };
 
 //////////////////////////////////////////////////////////////////////////////////////////
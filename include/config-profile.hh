@@ -0,0 +1,84 @@
+/**
+ * @file config-profile.hh
+ *
+ * Counts keyed lookups, to find the ones which belong outside of a hot loop.
+ */
+#ifndef __CONFIG_PROFILE_HH_
+#define __CONFIG_PROFILE_HH_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "config.hh"
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @class config_profile
+ *
+ * With the library and the application built with -DCONFIG_PROFILE (`scons profile=1`),
+ * every call of get<T>, get<T>(key, default), section, vector, has_kwarg, has_section,
+ * has_vector, get_path and has_path is counted.  Calls are grouped by accessor, by the
+ * fully qualified key and by the caller's return address.  Each is a candidate to be
+ * hoisted out of its loop or resolved once into a config_key.
+ *
+ *  o A key is qualified by the dotted path of its section in the config which owns it.
+ *    Sections are only walked when a report is taken or the config is destroyed, so a
+ *    lookup costs a hash of the key and an uncontended lock of its thread's table.
+ *  o A section shared by several includes (LOAD_CACHE_INCLUDES with LOAD_ARENA) is
+ *    reported under the first of its paths.
+ *  o The accessors are kept out of line so that their return address is the call site;
+ *    callers are symbolized with dladdr, which needs -rdynamic for the executable.
+ *
+ * Without CONFIG_PROFILE nothing is counted and the reports are empty.
+ *
+ * eg:
+ *   config_profile::report_at_exit(20);
+ *   ...
+ *   config_profile::report(std::cerr, 10);
+ */
+class config_profile {
+public:
+    struct entry {
+        config_access   access;
+        std::string     key;
+        const void*     caller;     /*< return address of the call >*/
+        uint64_t        calls;
+    };
+
+    /// the most called entries first; at most top_n of them, or every one for 0
+    static std::vector<entry> top(std::size_t top_n = 0);
+
+    /// writes top(top_n) as a table with symbolized callers
+    static void report(std::ostream& out, std::size_t top_n = 20);
+
+    /// writes report(std::cerr, top_n) when the process exits
+    static void report_at_exit(std::size_t top_n = 20);
+
+    /// forgets every call counted so far
+    static void reset();
+
+    /// "get", "section", ...
+    static const char* access_name(config_access access);
+
+private:
+    friend class config;
+
+    typedef std::unordered_map<const config_section*, std::string> path_map;
+
+    ///{@
+    /// a config is walked for the paths of its sections while it is live
+    static void _S_attach(const config* root);
+    static void _S_detach(const config* root);
+    ///@}
+
+    static void _S_paths(const config_section* section, const std::string& path
+                       , path_map& paths);
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //__CONFIG_PROFILE_HH_
@@ -0,0 +1,111 @@
+/**
+ * @file config-reload.hh
+ *
+ * A config which may be reloaded while other threads are reading it.
+ */
+#ifndef __CONFIG_RELOAD_HH_
+#define __CONFIG_RELOAD_HH_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "config.hh"
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @class config_handle
+ *
+ * Owns the current hierarchy loaded from a file.  Readers pin an immutable snapshot with
+ * acquire(), which is wait-free: it never takes a lock and never waits on a reload.  A
+ * reload parses the file into a new config on the calling thread, publishes it with a
+ * single atomic store and returns.  Each snapshot is released by whichever holder drops
+ * the last reference to it, which may be a reader.
+ *
+ * With config::LOAD_CACHE_INCLUDES the handle keeps the cache of parsed includes from
+ * one load to the next.  A reload still reads (and hashes) every file, but only parses
+ * those which changed, those which read a macro whose definition changed, and the files
+ * which include them; the rest of the tree is spliced from the previous load, and with
+ * config::LOAD_ARENA shared with the snapshots still holding it.
+ *
+ * A published snapshot is reached through a pointer which readers copy inside one of two
+ * counted windows (left-right); reload() retires the previous pointer once both windows
+ * have emptied.  A reader is inside a window only for the duration of a shared_ptr copy,
+ * so that wait is short regardless of how long snapshots are held.
+ *
+ * eg:
+ *   config_handle handle("app.cfg", config::LOAD_ARENA);
+ *
+ *   // request thread
+ *   config_handle::snapshot cfg = handle.acquire();
+ *   cfg->get<long>("port");
+ *
+ *   // background thread
+ *   handle.reload();
+ *
+ * @throw config_io_error           (construction, reload)
+ * @throw config_parse_exception    (construction, reload)
+ */
+class config_handle {
+public:
+    typedef std::shared_ptr<const config> snapshot;
+
+    explicit config_handle(const std::string& file_path
+                         , int flags = config::LOAD_DEFAULT);
+    ~config_handle();
+
+    /**
+     * The current snapshot.  It remains valid, and unchanged, for as long as the caller
+     * holds it.
+     *
+     * @complexity O(1), wait-free
+     */
+    snapshot acquire() const;
+
+    /**
+     * Loads the file again and publishes the result.  Concurrent reloads are serialized.
+     * If the load throws the current snapshot is left in place.
+     */
+    void reload();
+
+    /// number of snapshots published; 1 after construction
+    uint64_t generation() const
+    { return _M_generation.load(std::memory_order_acquire); }
+
+    const std::string& path() const
+    { return _M_path; }
+
+    int flags() const
+    { return _M_flags; }
+
+    config_handle(const config_handle&) = delete;
+    config_handle& operator=(const config_handle&) = delete;
+
+private:
+    /// one window per cache line so readers in different windows do not contend
+    struct alignas(64) reader_window {
+        std::atomic<uint64_t> count;
+    };
+
+    static snapshot _S_load(const std::string& file_path, int flags
+                          , include_cache* cache);
+
+    const std::string   _M_path;
+    const int           _M_flags;
+
+    /// kept between reloads; only used under _M_reload_lock (or by the constructor)
+    std::unique_ptr<include_cache>  _M_cache;
+
+    std::atomic<const snapshot*>    _M_current;
+    std::atomic<uint64_t>           _M_epoch;
+    std::atomic<uint64_t>           _M_generation;
+    mutable reader_window           _M_readers[2];
+    std::mutex                      _M_reload_lock;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //__CONFIG_RELOAD_HH_
@@ -0,0 +1,92 @@
+/**
+ * @file config-sax.hh
+ *
+ * Event driven access to a config file which builds no hierarchy.
+ */
+#ifndef __CONFIG_SAX_HH_
+#define __CONFIG_SAX_HH_
+
+#include <cstdint>
+#include <string>
+
+#include "config.hh"
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @struct config_scalar
+ *
+ * A single value as it was lexed; .type is one of kwarg::BOOL, kwarg::INTEGRAL,
+ * kwarg::FLOATING or kwarg::STRING and selects the field which is set.  .s refers to
+ * characters which are only valid for the duration of the callback.
+ */
+struct config_scalar {
+    config_scalar()
+        : type(kwarg::UNDEFINED), b(false), i(0), d(0), s("", 0)
+    {}
+
+    kwarg::TYPE type;
+    bool        b;
+    int64_t     i;
+    double      d;
+    kwarg_key   s;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @class config_handler
+ *
+ * Receives the events of config::stream.  Every assignment in a section is reported as
+ * on_key followed by its value, which is a single on_scalar, an on_section_begin ..
+ * on_section_end pair or an on_vector_begin .. on_vector_end pair; the elements of a
+ * vector are values without a key.
+ *
+ * eg:
+ *   port = 80
+ *   http = { hosts = [ "a", "b" ] }
+ *
+ *   on_key("port") on_scalar(80)
+ *   on_key("http") on_section_begin()
+ *       on_key("hosts") on_vector_begin() on_scalar("a") on_scalar("b") on_vector_end()
+ *   on_section_end()
+ *
+ * Events follow the text, with each @include expanded where it appears and every macro
+ * substituted.  A macro may only stand where a key could, never as a value (or vector
+ * element); config_parse_exception is thrown as config::load would.  Nothing is merged:
+ * a key assigned twice, or a section opened twice, is reported twice, and it is up to the
+ * handler to apply "last definition wins" should it need to.
+ *
+ * Each callback returns true to continue; returning false stops the parse.
+ */
+class config_handler {
+public:
+    virtual ~config_handler() {}
+
+    ///{@
+    virtual bool on_key(kwarg_key)
+    { return true; }
+
+    virtual bool on_scalar(const config_scalar&)
+    { return true; }
+    ///@}
+
+    ///{@
+    virtual bool on_section_begin()
+    { return true; }
+
+    virtual bool on_section_end()
+    { return true; }
+    ///@}
+
+    ///{@
+    virtual bool on_vector_begin()
+    { return true; }
+
+    virtual bool on_vector_end()
+    { return true; }
+    ///@}
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //__CONFIG_SAX_HH_
@@ -0,0 +1,94 @@
+/**
+ * @file config-trace.hh
+ *
+ * A timeline of config loads, written as Chrome trace events.
+ */
+#ifndef __CONFIG_TRACE_HH_
+#define __CONFIG_TRACE_HH_
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+#include "config.hh"
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @class config_trace
+ *
+ * Once installed, every config loaded (or reloaded through a config_handle) writes a span
+ * for each phase of the load into file_path as a Chrome trace event, which can be opened
+ * in chrome://tracing or https://ui.perfetto.dev:
+ *
+ *  load        the whole load of a root file, or of a compiled snapshot
+ *  read        opening and reading one file; with config::LOAD_MMAP the pages are only
+ *              faulted in while the file is parsed
+ *  parse       lexing and building the tree of one file, including the files it
+ *              includes in place
+ *  @define, @import, @include, @include*
+ *              one directive; an @include covers the read and parse of its file unless
+ *              config::LOAD_PARALLEL handed the file to a worker
+ *  section     one section body; config::LOAD_LAZY records a section when it is built
+ *  teardown    the destruction of a config
+ *
+ * Each event carries the file or key it concerns in args.detail, and the thread it ran on;
+ * the workers of config::LOAD_PARALLEL are threads of their own.  Timestamps are read from
+ * CLOCK_MONOTONIC, as are those of `perf record`, so the two can be lined up.
+ *
+ * Events are written as each span ends, so the file is readable (the trailing ']' is
+ * optional in the format) while a slow load is still in progress.
+ *
+ * A trace must outlive every load begun while it was installed.  Tracing costs a single
+ * branch per span while no trace is installed.
+ *
+ * Built with -DCONFIG_USDT (`scons usdt=1`) the same spans also fire the USDT probes
+ * appconf:phase__begin(category, name, detail) and appconf:phase__end(category, name),
+ * whether or not a trace is installed.
+ *
+ * eg:
+ *   config_trace trace("/tmp/load.json");
+ *   config_trace::install(&trace);
+ *   handle.reload();
+ *   config_trace::install(0x0);
+ *
+ * @throw config_io_error if file_path can not be written
+ */
+class config_trace {
+public:
+    explicit config_trace(const std::string& file_path);
+    ~config_trace();
+
+    ///{@
+    /// the trace which loads write to; 0x0 (the default) disables tracing
+    static void install(config_trace* trace)
+    { _S_installed.store(trace, std::memory_order_release); }
+
+    static config_trace* installed()
+    { return _S_installed.load(std::memory_order_acquire); }
+    ///@}
+
+    /// CLOCK_MONOTONIC in ns
+    static uint64_t now();
+
+    /// writes the span [begin_ns, end_ns) of the calling thread
+    void complete(const char* category, const char* name, const std::string& detail
+                , uint64_t begin_ns, uint64_t end_ns);
+
+    config_trace(const config_trace&) = delete;
+    config_trace& operator=(const config_trace&) = delete;
+
+private:
+    static std::atomic<config_trace*> _S_installed;
+
+    std::mutex      _M_lock;
+    std::ofstream   _M_out;
+    const int       _M_pid;
+    bool            _M_empty;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //__CONFIG_TRACE_HH_
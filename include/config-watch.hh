@@ -0,0 +1,108 @@
+/**
+ * @file config-watch.hh
+ *
+ * Reloads a config_handle when a file it was loaded from changes.
+ */
+#ifndef __CONFIG_WATCH_HH_
+#define __CONFIG_WATCH_HH_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "config.hh"
+#include "config-reload.hh"
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @class config_watcher
+ *
+ * Watches every file in config::sources() of the handle's current snapshot with inotify
+ * and calls config_handle::reload() on a background thread once one of them has really
+ * changed.
+ *
+ *  o The directory of each file is watched rather than the file itself, so editors which
+ *    save by renaming a new file into place are seen, as is the creation of an @include*
+ *    which was missing.  A directory which does not exist is waited for from its nearest
+ *    ancestor which does, and watched once it is created.  A watched directory which is
+ *    removed, or replaced by renaming another into its place (it or a directory above it
+ *    which is watched as well), is watched again by path.
+ *  o Events are debounced; a reload is considered once no watched file has been touched
+ *    for debounce_ms.
+ *  o A touched file is only a change if its contents hash differently from the bytes
+ *    which were parsed, so a save which rewrote the same contents reloads nothing.
+ *
+ * After each reload the watched set is rebuilt from the new snapshot's sources.  A reload
+ * which fails leaves the handle as it was and is counted in failures(); it is retried on
+ * the next change.  An error of the watch itself is counted there too, and the watch goes
+ * on once the debounce interval has passed.
+ *
+ * Linux only.
+ *
+ * @throw config_io_error if inotify is unavailable
+ */
+class config_watcher {
+public:
+    explicit config_watcher(config_handle& handle, unsigned debounce_ms = 100);
+    ~config_watcher();
+
+    ///{@
+    /// reloads performed, and reloads which threw (or errors of the watch itself)
+    uint64_t reloads() const
+    { return _M_reloads.load(std::memory_order_acquire); }
+
+    uint64_t failures() const
+    { return _M_failures.load(std::memory_order_acquire); }
+
+    /// what() of the most recent failure
+    std::string last_error() const;
+    ///@}
+
+    config_watcher(const config_watcher&) = delete;
+    config_watcher& operator=(const config_watcher&) = delete;
+
+private:
+    struct file_state {
+        bool        present;
+        uint64_t    hash;
+    };
+
+    static file_state _S_state(const std::string& path);
+
+    void _M_run();
+    void _M_reload(const std::unordered_set<std::string>& dirty);
+    void _M_fail(const std::string& what);
+    void _M_arm();
+    bool _M_watch();
+    /// whether any watched file differs from the state it was recorded in
+    bool _M_stale() const;
+    /// whether path is a directory above one which is watched
+    bool _M_encloses(const std::string& path) const;
+    bool _M_changed(const std::unordered_set<std::string>& paths) const;
+
+    config_handle&  _M_handle;
+    const unsigned  _M_debounce_ms;
+    int             _M_inotify;
+    int             _M_wake[2];
+
+    std::unordered_map<int, std::string>            _M_dirs;    /*< wd -> directory >*/
+    std::unordered_map<std::string, file_state>     _M_files;   /*< path -> as parsed >*/
+    std::unordered_set<std::string>                 _M_missing; /*< awaited directories >*/
+    std::unordered_set<std::string>                 _M_dirty;
+
+    std::atomic<uint64_t>   _M_reloads;
+    std::atomic<uint64_t>   _M_failures;
+    mutable std::mutex      _M_error_lock;
+    std::string             _M_last_error;
+
+    std::thread             _M_thread;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //__CONFIG_WATCH_HH_
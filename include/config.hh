@@ -1,15 +1,22 @@
 #ifndef __CONFIG_HH_
 #define __CONFIG_HH_
 
+#include <atomic>
+#include <cstring>
 #include <iterator>
-#include <map>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <sstream>
 #include <vector>
+#if __cplusplus >= 201703L
+#  include <string_view>
+#endif
 
 #include "config-bits.hh"
+#include "bits/arena.hh"
+#include "bits/symbols.hh"
 
 #if defined(CONFIG_SINGLETON)
 #  define CFG config::instance()
@@ -76,7 +83,7 @@ private:
         std::stringstream ss;
 
         ss << "ERROR [" << key << "]" << std::endl;
-        ss << "  --> '" << std::string((iter - lsize), (iter + rsize)) << "'";
+        ss << "  --> '" << iter.context(lsize, rsize) << "'";
         return ss.str();
     }
 };
@@ -85,34 +92,165 @@ private:
 //////////////////////////////////////////////////////////////////////////////////////////
 // KWARG ACCESS
 //////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @class kwarg_key
+ *
+ * A non-owning reference to a key name.  Every lookup accepts one so that literals,
+ * std::string (and std::string_view where available) can be passed without building a
+ * temporary std::string.  It must not outlive the characters it refers to.
+ *
+ * A key made from an interned symbol (kwarg::name(), config::intern) refers to the
+ * symbol's own characters, and so to the symbol; a section looks it up by the hash stored
+ * in the symbol and matches the child which holds the same symbol without comparing
+ * characters.  A key is kept to two words, so that it is passed in registers.
+ */
+class kwarg_key {
+public:
+    kwarg_key(const char* key)
+        : _M_data(key), _M_size(static_cast<uint32_t>(std::strlen(key)))
+        , _M_interned(false)
+    {}
+
+    kwarg_key(const char* key, std::size_t size)
+        : _M_data(key), _M_size(static_cast<uint32_t>(size)), _M_interned(false)
+    {}
+
+    kwarg_key(const std::string& key)
+        : _M_data(key.data()), _M_size(static_cast<uint32_t>(key.size()))
+        , _M_interned(false)
+    {}
+
+#if __cplusplus >= 201703L
+    kwarg_key(std::string_view key)
+        : _M_data(key.data()), _M_size(static_cast<uint32_t>(key.size()))
+        , _M_interned(false)
+    {}
+#endif
+
+    explicit kwarg_key(const config_symbol& symbol)
+        : _M_data(symbol.data()), _M_size(symbol.size), _M_interned(true)
+    {}
+
+    const char* data() const { return _M_data; }
+    std::size_t size() const { return _M_size; }
+
+    /// the interned symbol of the key, if it was made from one
+    const config_symbol* symbol() const {
+        return _M_interned ? reinterpret_cast<const config_symbol*>(_M_data) - 1 : 0x0;
+    }
+
+    std::string str() const
+    { return std::string(_M_data, _M_size); }
+
+    operator std::string() const
+    { return str(); }
+
+private:
+    const char* _M_data;
+    uint32_t    _M_size;
+    bool        _M_interned;
+};
+
+///{@
+/// keys compare by their characters
+inline bool
+operator==(kwarg_key lhs, kwarg_key rhs) {
+    if (lhs.data() == rhs.data() && lhs.size() == rhs.size())
+        return true;
+
+    return lhs.size() == rhs.size() && 0 == memcmp(lhs.data(), rhs.data(), lhs.size());
+}
+
+inline bool
+operator!=(kwarg_key lhs, kwarg_key rhs) {
+    return ! (lhs == rhs);
+}
+
+inline std::ostream&
+operator<<(std::ostream& out, kwarg_key key) {
+    return out << key.str();
+}
+///@}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// ACCESS PROFILING
+//////////////////////////////////////////////////////////////////////////////////////////
+class config_section;
+
+/// the keyed accessors counted by a CONFIG_PROFILE build; @see config_profile
+enum config_access { ACCESS_GET, ACCESS_GET_DEFAULT, ACCESS_SECTION, ACCESS_VECTOR
+                   , ACCESS_HAS, ACCESS_GET_PATH };
+
+/// counts one lookup of key in section, made from caller
+void config_profile_note(const config_section* section, kwarg_key key
+                       , config_access access, const void* caller);
+
+#if defined(CONFIG_PROFILE)
+/* an accessor is kept out of line so that its return address is that of its caller */
+#  define CONFIG_ACCESSOR __attribute__((noinline))
+#  define CONFIG_PROFILE_NOTE(_access_, _key_) \
+       config_profile_note(this, (_key_), (_access_), __builtin_return_address(0))
+#else
+#  define CONFIG_ACCESSOR
+#  define CONFIG_PROFILE_NOTE(_access_, _key_) do {} while (0)
+#endif
+
 /**
  * @class kwarg
  *
  * Every type in libconf is a subclass of `kwarg`.  A kwarg (and all subclass') are
  * non-movable.  The kwarg subclass holds nothing but the name and type of the super class
  * element.
+ *
+ * The hierarchy has no virtual functions; nodes are told apart by type() alone, so that
+ * a node costs no vtable pointer and a typed read is a switch on a field it has already
+ * loaded.  A scalar node (kwarg_const) is three words.
  */
 class kwarg {
 public:
     enum TYPE { FLOATING, INTEGRAL, STRING, SECTION, UNDEFINED, VECTOR, BOOL };
 
-    kwarg(const std::string& name, TYPE type)
+    /// name is a symbol of the table of the config the node belongs to
+    kwarg(const config_symbol* name, TYPE type)
         : _M_name(name), _M_type(type)
     {}
 
-    virtual ~kwarg() {}
-
-    std::string name() const
-    { return _M_name; }
+    /// a view of the interned name; valid for as long as the config
+    kwarg_key name() const
+    { return kwarg_key(*_M_name); }
 
     TYPE type() const
     { return _M_type; }
 
+    ///{@
+    /**
+     * Nodes of a tree loaded with config::LOAD_ARENA are placed in the arena of the
+     * owning config and are never individually deleted.  A null arena falls back to the
+     * global heap.
+     */
+    static void* operator new(std::size_t size)
+    { return ::operator new(size); }
+
+    static void* operator new(std::size_t size, config_arena* arena)
+    { return _S_allocate(size, arena); }
+
+    static void operator delete(void* ptr)
+    { ::operator delete(ptr); }
+
+    static void operator delete(void* ptr, config_arena* arena) {
+        if (0x0 == arena)
+            kwarg::operator delete(ptr);
+    }
+    ///@}
+
     kwarg& operator=(const kwarg&) = delete;
     kwarg(const kwarg&) = delete;
     kwarg(kwarg&&) = delete;
 
 protected:
+    /// not virtual; a heap node is deleted as its own type by _S_delete
+    ~kwarg() {}
+
     ///{@
     /**
      * These template macros are used inside std::enable_if<...> specializations as a
@@ -138,46 +276,81 @@ protected:
     struct is_string {
         static constexpr bool value = std::is_same<std::string, _K>::value;
     };
+
+    /// reads of a string which refer to the characters held by the node
+    template <typename _K>
+    struct is_string_ref {
+        static constexpr bool value = std::is_same<const char*, _K>::value
+#if __cplusplus >= 201703L
+                                   || std::is_same<std::string_view, _K>::value
+#endif
+                                    ;
+    };
     ///@}
 
 private:
-    const std::string _M_name;
+    friend class config_section;
+    friend class kwarg_vector;
+    template <typename> friend class config_key;
+
+    /**
+     * Kept apart from operator new so that the operator itself is always inlined; GCC
+     * otherwise pairs the heap fallback with the placement delete and warns of a
+     * mismatch (-Wmismatched-new-delete) that is not there.
+     */
+    static void*
+    _S_allocate(std::size_t size, config_arena* arena)
+    { return arena ? arena->allocate(size, alignof(void*)) : ::operator new(size); }
+
+    /// deletes a heap node of any type
+    static void _S_delete(kwarg* ptr);
+
+    const config_symbol* const _M_name;
     const TYPE _M_type;
 };
 
 /**
  * @class kwarg_const
  * Represents access to any primitive data type.
+ *
+ * The value is held inline; a string holds its characters, NUL terminated, in the arena
+ * of its node (or on the heap) and its size in what would otherwise be the padding of the
+ * kwarg base.
  */
 class kwarg_const : public kwarg {
 public:
     ///{@
-    kwarg_const(bool data, std::string name)
-        : kwarg(name, kwarg::BOOL)
+    kwarg_const(bool data, const config_symbol* name, config_arena* = 0x0)
+        : kwarg(name, kwarg::BOOL), _M_size(0)
     { _M_data.boolean = data; }
 
-    kwarg_const(int64_t data, std::string name)
-        : kwarg(name, kwarg::INTEGRAL)
-    { _M_data.floating = static_cast<double>(data); }
+    kwarg_const(int64_t data, const config_symbol* name, config_arena* = 0x0)
+        : kwarg(name, kwarg::INTEGRAL), _M_size(0)
+    { _M_data.integral = data; }
 
-    kwarg_const(double data, std::string name)
-        : kwarg(name, kwarg::FLOATING)
+    kwarg_const(double data, const config_symbol* name, config_arena* = 0x0)
+        : kwarg(name, kwarg::FLOATING), _M_size(0)
     { _M_data.floating = data; }
 
-    kwarg_const(std::string data, std::string name)
-        : kwarg(name, kwarg::STRING)
-    { _M_data.str = data; }
+    kwarg_const(const std::string& data, const config_symbol* name
+              , config_arena* arena = 0x0);
     ///@}
 
+    ~kwarg_const();
+
     ///{@
     /**
      * These accessor functions are needed due to the local union.  It must first access
-     * the proper union element and then perform a proper cast.
+     * the proper union element and then perform a proper cast.  Integral and floating
+     * values may be read as one another.
      */
     template <typename _Tp>
     typename std::enable_if<is_integral<_Tp>::value, _Tp>::type
     as() const {
-        return static_cast<_Tp>(_M_data.floating);
+        if (type() == kwarg::INTEGRAL)
+            return static_cast<_Tp>(_M_data.integral);
+        else
+            return static_cast<_Tp>(_M_data.floating);
     }
 
     template <typename _Tp>
@@ -189,58 +362,234 @@ public:
     template <typename _Tp>
     typename std::enable_if<is_floating<_Tp>::value, _Tp>::type
     as() const {
-        return static_cast<_Tp>(_M_data.floating);
+        if (type() == kwarg::INTEGRAL)
+            return static_cast<_Tp>(_M_data.integral);
+        else
+            return static_cast<_Tp>(_M_data.floating);
     }
 
+    /// a value which is not a string reads as ""
     template <typename _Tp>
     typename std::enable_if<is_string<_Tp>::value, _Tp>::type
     as() const {
-        return _M_data.str;
+        if (type() != kwarg::STRING)
+            return _Tp();
+
+        return _Tp(_M_data.chars, _M_size);
     }
-    ///@}
 
-private:
     /**
-     * note:  .str element was once in the union via C++11 unrestricted union.  This was
-     * deemed not worth the effort of managing the potential memory leaks inside the
-     * destructor.
+     * as<const char*>() (and as<std::string_view>() in C++17) copy nothing; they refer to
+     * the characters of the node, which are NUL terminated and never move or change for
+     * as long as the config lives.  A value which is not a string reads as "".
      */
-    struct __kwarg_const_union {
-        union {
-            double  floating;
-            bool    boolean;
-        };
+    template <typename _Tp>
+    typename std::enable_if<is_string_ref<_Tp>::value, _Tp>::type
+    as() const {
+        if (type() != kwarg::STRING)
+            return _Tp("");
+
+        return _S_chars<_Tp>(_M_data.chars, _M_size);
+    }
+    ///@}
 
-        std::string str;
+private:
+    template <typename _Tp>
+    static typename std::enable_if<std::is_pointer<_Tp>::value, _Tp>::type
+    _S_chars(const char* chars, std::size_t)
+    { return chars; }
+
+    template <typename _Tp>
+    static typename std::enable_if<! std::is_pointer<_Tp>::value, _Tp>::type
+    _S_chars(const char* chars, std::size_t size)
+    { return _Tp(chars, size); }
+
+    uint32_t _M_size;       /*< of a string >*/
+
+    union {
+        int64_t     integral;
+        double      floating;
+        bool        boolean;
+        const char* chars;
     } _M_data;
 };
 
+/**
+ * @class config_span
+ * @template _Tp int64_t, double or bool
+ *
+ * A read-only view of contiguous elements; @see kwarg_vector::span()
+ */
+template <typename _Tp>
+class config_span {
+public:
+    typedef _Tp value_type;
+    typedef const _Tp* const_iterator;
+
+    config_span()
+        : _M_data(0x0), _M_size(0)
+    {}
+
+    config_span(const _Tp* data, std::size_t size)
+        : _M_data(data), _M_size(size)
+    {}
+
+    const _Tp* data() const { return _M_data; }
+    std::size_t size() const { return _M_size; }
+    bool empty() const { return 0 == _M_size; }
+
+    const_iterator begin() const { return _M_data; }
+    const_iterator end()   const { return _M_data + _M_size; }
+
+    const _Tp& operator[](std::size_t i) const
+    { return _M_data[i]; }
+
+private:
+    const _Tp*  _M_data;
+    std::size_t _M_size;
+};
+
 /**
  * A kwarg vector has no implemented functions of its own.  Rather, it exposes the
  * internal vector<kwarg_const*> object via the -> operator.  As a consequence it is
  * generally as fast as the equivalent vector<_Tp>
+ *
+ * Vectors whose elements are all numbers or all booleans are instead stored as a single
+ * contiguous array at parse time which span<_Tp>() exposes directly.  Integral elements
+ * in a vector which also holds floating elements are promoted to double.  A packed vector
+ * keeps no node per element; the -> operator builds them the first time it is used, and
+ * at(...) (which paths resolve through) only those of the elements it reads.
  */
 class kwarg_vector : public kwarg {
 public:
-    kwarg_vector(const std::string& name, std::vector<kwarg_const*>& source)
-        : kwarg(name, kwarg::VECTOR), _M_vector(source)
-    { }
+    typedef std::vector<kwarg_const*, arena_allocator<kwarg_const*>> vector_type;
 
-    virtual ~kwarg_vector() {
-        for (auto it = _M_vector.cbegin(); it != _M_vector.cend(); ++it) {
-            delete ((*it));
-        }
-    }
+    /**
+     * Takes the elements of source, leaving it empty.  They must be nodes of arena (or of
+     * the heap if it is null), and source must allocate from arena.  The vector is not
+     * packed; the parser packs a vector of numbers or booleans as it reads it.
+     */
+    kwarg_vector(const config_symbol* name, vector_type& source
+               , config_arena* arena = 0x0);
+
+    /// copies the values of a packed vector
+    kwarg_vector(const config_symbol* name, const kwarg_vector& packed
+               , config_arena* arena = 0x0);
+
+    /**
+     * A packed vector of size elements of type (INTEGRAL, FLOATING or BOOL), copied from
+     * data as they are laid out by span<_Tp>().
+     */
+    kwarg_vector(const config_symbol* name, TYPE type, const void* data
+               , std::size_t size, config_arena* arena = 0x0);
+
+    ~kwarg_vector();
 
-    const std::vector<kwarg_const*>*
+    /**
+     * The elements as nodes.  Those of a packed vector are built on the first call and
+     * kept for the life of the vector, at a node per element; read a large packed vector
+     * through span<_Tp>() instead.
+     */
+    const vector_type*
     operator->() const {
-        return &_M_vector;
+        if (kwarg::UNDEFINED == _M_value_type)
+            return &_M_vector;
+
+        const element_views* views = _M_views.load(std::memory_order_acquire);
+        return views ? &views->nodes : _M_build_views();
+    }
+
+    /// the number of elements, which never builds the nodes of a packed vector
+    std::size_t size() const
+    { return _M_size; }
+
+    /**
+     * The element at index, which must be less than size().  A packed vector builds the
+     * node of an element (and of the ELEMENT_PAGE elements around it) the first time it
+     * is read this way, and keeps it for the life of the vector; the nodes of elements
+     * which are never read are never built.
+     */
+    kwarg_const*
+    at(std::size_t index) const {
+        if (kwarg::UNDEFINED == _M_value_type)
+            return _M_vector[index];
+
+        const element_views* views = _M_views.load(std::memory_order_acquire);
+        return views ? views->nodes[index] : _M_element(index);
+    }
+
+    /**
+     * The type shared by every element (INTEGRAL, FLOATING or BOOL) of a packed vector, or
+     * UNDEFINED if the vector is empty or holds strings, sections or mixed types.
+     */
+    TYPE value_type() const
+    { return _M_value_type; }
+
+    /**
+     * Contiguous access to a packed vector.  _Tp must be exactly the storage type;
+     * int64_t for INTEGRAL, double for FLOATING and bool for BOOL.
+     *
+     * @throw config_type_error
+     */
+    template <typename _Tp>
+    config_span<_Tp>
+    span() const {
+        static_assert(std::is_same<_Tp, int64_t>::value
+                   || std::is_same<_Tp, double>::value
+                   || std::is_same<_Tp, bool>::value
+                    , "span<_Tp> requires int64_t, double or bool");
+
+        const TYPE type = std::is_same<_Tp, bool>::value   ? kwarg::BOOL
+                        : std::is_same<_Tp, double>::value ? kwarg::FLOATING
+                        :                                    kwarg::INTEGRAL;
+
+        if (type != _M_value_type)
+            throw config_type_error(name());
+
+        return config_span<_Tp>(static_cast<const _Tp*>(_M_packed), _M_size);
     }
+
 private:
-    const std::vector<kwarg_const*> _M_vector;
+    friend class config_section;
+
+    enum { ELEMENT_PAGE = 64 };
+
+    /// the nodes of a packed vector, in one block
+    struct element_views {
+        vector_type  nodes;
+        kwarg_const* storage;
+    };
+
+    /// the nodes of a packed vector built by at(...), a block of ELEMENT_PAGE at a time
+    struct element_pages {
+        std::size_t                 count;
+        std::atomic<kwarg_const*>*  pages;
+    };
+
+    /// a packed vector whose storage is left for config_section to fill
+    kwarg_vector(const config_symbol* name, TYPE type, std::size_t size
+               , config_arena* arena);
+
+    const vector_type* _M_build_views() const;
+    kwarg_const* _M_element(std::size_t index) const;
+    static void _S_release_pages(void* pages);
+    /// constructs a node holding the element at index of a packed vector
+    void _M_construct(void* node, std::size_t index) const;
+    static void _S_release_views(void* views);
+
+    vector_type   _M_vector;        /*< the elements, unless packed >*/
+    TYPE          _M_value_type;
+    std::size_t   _M_size;
+    void*         _M_packed;
+    config_arena* _M_arena;
+    mutable std::atomic<const element_views*> _M_views;
+    mutable std::atomic<element_pages*> _M_pages;
 };
 
 
+template <typename _Tp>
+class config_key;
+
 //////////////////////////////////////////////////////////////////////////////////////////
 // CONFIG SECTIONS
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -249,11 +598,15 @@ private:
  *
  * Represents the "object" element of the config library in that it internally maps
  * key->value pairs.
+ *
+ * Children are kept in definition order in a flat list which is indexed by an open
+ * addressing hash table, so lookups are O(1) and never allocate.  Iteration visits the
+ * children in the order they were first defined.
  */
 class config_section : public kwarg {
 public:
-    typedef std::map<std::string, kwarg*> map_type;
-    typedef map_type::const_iterator const_iterator;
+    typedef std::vector<kwarg*, arena_allocator<kwarg*>> list_type;
+    typedef list_type::const_iterator const_iterator;
 
     ///{@
     /**
@@ -263,26 +616,38 @@ public:
      * @throw config_key_error
      * @throw config_type_error
      */
-    config_section* section(const std::string& name) const;
-    config_section* object(const std::string& name) const { return this->section(name); }
-    kwarg_vector& vector(const std::string& key) const {
+    CONFIG_ACCESSOR config_section* section(kwarg_key name) const;
+
+    CONFIG_ACCESSOR config_section* object(kwarg_key name) const {
+        CONFIG_PROFILE_NOTE(ACCESS_SECTION, name);
+        return static_cast<config_section*>(_M_get_kwarg(name));
+    }
+
+    CONFIG_ACCESSOR kwarg_vector& vector(kwarg_key key) const {
+        CONFIG_PROFILE_NOTE(ACCESS_VECTOR, key);
         return *static_cast<kwarg_vector*>(_M_get_kwarg(key));
     }
     ///@}
 
     ///{@
+    /**
+     * iterates each child kwarg* in definition order; the key is (*it)->name()
+     */
     const_iterator cbegin() const;
     const_iterator cend() const;
+    std::size_t size() const { _M_touch(); return _M_kwargs.size(); }
     ///@}
 
     ///{@
     /**
-     * @template _Tp should be a primitive
+     * @template _Tp should be a primitive; a string is copied into a std::string, or
+     *           read in place as a const char* (or std::string_view); @see kwarg_const
      * @throw config_key_error
      */
     template <typename _Tp>
-    _Tp
-    get(const std::string& key) const {
+    CONFIG_ACCESSOR _Tp
+    get(kwarg_key key) const {
+        CONFIG_PROFILE_NOTE(ACCESS_GET, key);
         return static_cast<kwarg_const*>(_M_get_kwarg(key))->as<_Tp>();
     }
 
@@ -291,68 +656,408 @@ public:
      * returns the value passed to deflt instead of excepting.
      */
     template <typename _Tp>
-    _Tp
-    get(const std::string& key, const _Tp& deflt) const {
-        auto it = _M_kwargs.find(key);
+    CONFIG_ACCESSOR _Tp
+    get(kwarg_key key, const _Tp& deflt) const {
+        CONFIG_PROFILE_NOTE(ACCESS_GET_DEFAULT, key);
+        kwarg* ptr = _M_find_kwarg(key);
 
-        if (it == _M_kwargs.end())
+        if (0x0 == ptr)
             return deflt;
         else
-            return static_cast<kwarg_const*>(_M_get_kwarg(key))->as<_Tp>();
+            return static_cast<kwarg_const*>(ptr)->as<_Tp>();
     }
     ///@}
 
+    /**
+     * Walks a dotted path down the hierarchy without allocating.  Any element may index
+     * into a vector, and the path goes on through an element which is a section.
+     *
+     * eg:
+     *   "section_1.section_2.integer_data"
+     *   "section_1.data_vector[3]"
+     *   "section_1.servers[0].port"
+     *
+     * @return the kwarg or 0x0 if any element of the path does not exist
+     */
+    kwarg* resolve(kwarg_key path) const;
+
+    /**
+     * Resolves path once into a typed handle; @see config_key
+     */
+    template <typename _Tp>
+    config_key<_Tp>
+    key(kwarg_key path) const {
+        return config_key<_Tp>(*this, path);
+    }
+
     ///{@
     /**
      * element checks.  if the has_{type} implies a specific kwarg type it will return
      * false if an identical key with a different type exists.
      */
-    bool has_kwarg(const std::string& key) const;
-    bool has_section(const std::string& key) const;
-    bool has_vector(const std::string& key) const;
+    CONFIG_ACCESSOR bool has_kwarg(kwarg_key key) const;
+    CONFIG_ACCESSOR bool has_section(kwarg_key key) const;
+    CONFIG_ACCESSOR bool has_vector(kwarg_key key) const;
     ///@}
 
     /// do not rely on this function : simply prints data out to stderr
     void dump(int depth = 0);
 
 protected:
-    config_section(const std::string& name);
-    virtual ~config_section();
+    config_section(const config_symbol* name, config_arena* arena = 0x0);
+    ~config_section();
 
     ///{@
     /**
      * ::_M_get_kwarg(...) functions @throw config_key_error
+     * ::_M_find_kwarg(...) returns 0x0 if the key does not exist
+     * ::_M_find_parsed(...) is _M_find_kwarg without building a lazy section; for the
+     * parser, which only ever looks at what it has parsed so far
      */
     void _M_set_kwarg(kwarg* val);
-    kwarg* _M_get_kwarg(const std::string& key) const;
-    kwarg* _M_get_kwarg(const std::string& key, kwarg::TYPE t) const;
+    kwarg* _M_find_kwarg(kwarg_key key) const;
+    kwarg* _M_find_parsed(kwarg_key key) const;
+    kwarg* _M_get_kwarg(kwarg_key key) const;
+    kwarg* _M_get_kwarg(kwarg_key key, kwarg::TYPE t) const;
     ///@}
 
     ///{@
-    void _M_parse_file(const std::string& file_path, parse_trie<std::string>* regs 
+    /**
+     * The arena this section (and every node below it) was allocated from, or 0x0 if the
+     * tree lives on the heap.
+     */
+    config_arena* _M_get_arena() const
+    { return _M_kwargs.get_allocator().arena(); }
+
+    /**
+     * Drops every child without visiting it.  Only valid when the children live in an
+     * arena which is about to be released.
+     */
+    void _M_abandon_kwargs();
+
+    /// deletes every child of a heap backed tree
+    void _M_release_kwargs();
+    ///@}
+
+    ///{@
+    void _M_parse_file(const std::string& file_path, parse_context& ctx
                      , bool optional = false);
-    void _M_parse_iterator(_Iter& iter, parse_trie<std::string>* regs);
+    void _M_parse_iterator(_Iter& iter, parse_context& ctx);
     ///@}
 
     ///{@
-    void _M_parse_macro(_Iter& iter, parse_trie<std::string>* regs);
-    void _M_parse_define(_Iter& iter, parse_trie<std::string>* regs);
-    void _M_parse_import(_Iter& iter, parse_trie<std::string>* regs);
-    void _M_parse_include(_Iter& iter, parse_trie<std::string>* regs, bool optional);
+    void _M_parse_macro(_Iter& iter, parse_context& ctx);
+    void _M_parse_define(_Iter& iter, parse_context& ctx);
+    void _M_parse_import(_Iter& iter, parse_context& ctx);
+    void _M_parse_include(_Iter& iter, parse_context& ctx, bool optional);
     ///@}
 
     ///{@
-    kwarg* _M_parse_kwarg(std::string key, _Iter& iter, parse_trie<std::string>* regs);
-    kwarg* _M_parse_vector(std::string key, _Iter& iter, parse_trie<std::string>* regs);
+    /// an element of a vector is always a new node; only a keyed section merges
+    kwarg* _M_parse_kwarg(const config_symbol* key, _Iter& iter, parse_context& ctx
+                        , bool element = false);
+    kwarg* _M_parse_vector(const config_symbol* key, _Iter& iter, parse_context& ctx);
+    ///@}
+
+    ///{@
+    /**
+     * Moves every child of detached into this section as though its text had been parsed
+     * here; sections merge with an existing section of the same name unless they are in
+     * replacing.  detached is consumed.
+     *
+     * With share the children are instead shared with (LOAD_ARENA) or copied from (heap)
+     * detached, which is left untouched.  outer is the replacing set of a detached parse
+     * this section belongs to, if any.
+     */
+    void _M_splice(config_section* detached
+                 , const std::unordered_set<const kwarg*>& replacing
+                 , bool share, std::unordered_set<const kwarg*>* outer);
+    void _M_include_cached(const std::string& file_path, parse_context& ctx
+                         , bool optional);
+    ///@}
+
+    ///{@
+    /**
+     * Sections shared with the include cache are copied on write.
+     * ::_M_writable_section replaces child (of this section) with a shallow copy if it
+     * is shared and returns the section which may be modified.
+     */
+    config_section* _M_writable_section(config_section* child
+                                      , std::unordered_set<const kwarg*>* replacing);
+    kwarg* _M_share(kwarg* child);
+    static kwarg* _S_clone(const kwarg* src, config_arena* arena);
+    ///@}
+
+    ///{@
+    /**
+     * A section loaded with LOAD_LAZY is built the first time one of its children is
+     * read; every public accessor calls _M_touch() first.
+     */
+    void
+    _M_touch() const {
+        if (0x0 != _M_lazy.load(std::memory_order_acquire))
+            _M_materialize();
+    }
+
+    void _M_materialize() const;
     ///@}
 
 private:
-    map_type _M_kwargs;
+    friend class config_profile;
+    friend class include_cache;
+    friend class kwarg;
+    friend class include_loader;
+    friend class lazy_loader;
+    friend class snapshot_reader;
+
+    /**
+     * slot of the open addressing index; .index is 1 + the position in _M_kwargs so a
+     * zeroed slot is empty.  .hash is kept so that probing rarely touches a kwarg.
+     */
+    struct index_slot {
+        uint32_t hash;
+        uint32_t index;
+    };
+
+    typedef std::vector<index_slot, arena_allocator<index_slot>> slot_type;
+
+    void _M_rehash(std::size_t capacity);
+
+    list_type _M_kwargs;
+    slot_type _M_slots;
+    bool      _M_shared;    /*< reachable from the include cache; @see _M_share >*/
+
+    mutable std::atomic<lazy_body*> _M_lazy;    /*< unparsed bodies; @see LOAD_LAZY >*/
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// RESOLVED KEYS
+//////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @class config_key
+ * @template _Tp a primitive, kwarg_vector or config_section
+ *
+ * A dotted path resolved once against a loaded hierarchy.  Dereferencing it afterwards
+ * costs a pointer load (plus the as<_Tp>() cast for primitives); no string is hashed or
+ * compared.  The tree is immutable once loaded so a key stays valid for as long as the
+ * config it was resolved against.
+ *
+ * eg:
+ *   auto data = CFG->key<long>("section_1.section_2.integer_data");
+ *
+ *   for (...)
+ *       use(*data);
+ *
+ * @throw config_key_error   at construction if the path does not exist, or names a
+ *                           section or a vector
+ * @throw config_type_error  at construction if the kwarg can not be read as a _Tp
+ */
+template <typename _Tp>
+class config_key {
+public:
+    config_key()
+        : _M_ptr(0x0)
+    {}
+
+    config_key(const config_section& root, kwarg_key path)
+        : _M_ptr(static_cast<const kwarg_const*>(_S_resolve(root, path)))
+    {}
+
+    _Tp operator*() const
+    { return _M_ptr->as<_Tp>(); }
+
+    _Tp get() const
+    { return _M_ptr->as<_Tp>(); }
+
+    const kwarg_const* ptr() const
+    { return _M_ptr; }
+
+    explicit operator bool() const
+    { return 0x0 != _M_ptr; }
+
+private:
+    static const kwarg*
+    _S_resolve(const config_section& root, kwarg_key path) {
+        const kwarg* ptr = root.resolve(path);
+
+        if (0x0 == ptr)
+            throw config_key_error(path.str());
+
+        switch (ptr->type()) {
+            case kwarg::BOOL:
+                if (std::is_same<_Tp, bool>::value)
+                    return ptr;
+                break;
+
+            case kwarg::STRING:
+                if (kwarg::is_string<_Tp>::value || kwarg::is_string_ref<_Tp>::value)
+                    return ptr;
+                break;
+
+            case kwarg::INTEGRAL:
+            case kwarg::FLOATING:
+                if (std::is_arithmetic<_Tp>::value && ! std::is_same<_Tp, bool>::value)
+                    return ptr;
+                break;
+
+            case kwarg::SECTION:
+            case kwarg::VECTOR:
+                throw config_key_error(path.str());
+
+            default:
+                break;
+        }
+
+        throw config_type_error(path.str());
+    }
+
+    const kwarg_const* _M_ptr;
+};
+
+/**
+ * A resolved vector.  Like kwarg_vector itself the -> operator exposes the internal
+ * vector; eg: key->cbegin(), key->size().
+ */
+template <>
+class config_key<kwarg_vector> {
+public:
+    config_key()
+        : _M_ptr(0x0)
+    {}
+
+    config_key(const config_section& root, kwarg_key path)
+        : _M_ptr(static_cast<const kwarg_vector*>(
+                    _S_resolve(root, path, kwarg::VECTOR)))
+    {}
+
+    const kwarg_vector& operator*() const
+    { return *_M_ptr; }
+
+    const kwarg_vector& operator->() const
+    { return *_M_ptr; }
+
+    const kwarg_vector* ptr() const
+    { return _M_ptr; }
+
+    explicit operator bool() const
+    { return 0x0 != _M_ptr; }
+
+private:
+    static const kwarg*
+    _S_resolve(const config_section& root, kwarg_key path, kwarg::TYPE type) {
+        const kwarg* ptr = root.resolve(path);
+
+        if (0x0 == ptr)
+            throw config_key_error(path.str());
+        else if (ptr->type() != type)
+            throw config_type_error(path.str());
+        else
+            return ptr;
+    }
+
+    const kwarg_vector* _M_ptr;
+};
+
+/**
+ * A resolved section.
+ */
+template <>
+class config_key<config_section> {
+public:
+    config_key()
+        : _M_ptr(0x0)
+    {}
+
+    config_key(const config_section& root, kwarg_key path)
+        : _M_ptr(_S_resolve(root, path))
+    {}
+
+    const config_section& operator*() const
+    { return *_M_ptr; }
+
+    const config_section* operator->() const
+    { return _M_ptr; }
+
+    const config_section* ptr() const
+    { return _M_ptr; }
+
+    explicit operator bool() const
+    { return 0x0 != _M_ptr; }
+
+private:
+    static const config_section*
+    _S_resolve(const config_section& root, kwarg_key path) {
+        const kwarg* ptr = root.resolve(path);
+
+        if (0x0 == ptr)
+            throw config_key_error(path.str());
+        else if (ptr->type() != kwarg::SECTION)
+            throw config_type_error(path.str());
+        else
+            return static_cast<const config_section*>(ptr);
+    }
+
+    const config_section* _M_ptr;
 };
 
 //////////////////////////////////////////////////////////////////////////////////////////
 // CONFIG ROOT OBJECT
 //////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @struct config_source
+ *
+ * A file which was read while loading a config, or which was looked for and did not
+ * exist (a missing @include*).  @see config::sources
+ */
+struct config_source {
+    std::string path;       /*< absolute >*/
+    bool        present;
+    uint64_t    hash;       /*< of the contents as they were parsed; 0 if not present >*/
+};
+
+/**
+ * @struct parse_stats
+ *
+ * What loading a config cost, per file and in total.  @see config::stats
+ *
+ * .files holds one entry per file parsed, in the order their parse began; a file included
+ * twice is listed twice.  An @include reused from LOAD_CACHE_INCLUDES parses nothing and
+ * is not listed.  Sections which LOAD_LAZY builds after the load are not counted.
+ *
+ * .wall_ns of a file includes the files it included which were parsed in place; .self_ns
+ * does not.  An @include parsed by a LOAD_PARALLEL worker is timed on the worker.
+ *
+ * .kwargs counts every node created (values, vector elements, sections and vectors), of
+ * which .sections and .vectors are the sections and vectors.  .trie_lookups counts macro
+ * lookups and keyword matches (booleans and @ statements); .macro_expansions the macro
+ * lookups which resolved.
+ *
+ * .total sums every file; its .wall_ns is that of the whole load and its .include_depth
+ * the deepest of any file.  With LOAD_COMPILED only .bytes and .wall_ns are recorded.
+ */
+struct parse_stats {
+    struct file {
+        file()
+            : bytes(0), wall_ns(0), self_ns(0), kwargs(0), sections(0), vectors(0)
+            , macro_expansions(0), trie_lookups(0), include_depth(0)
+        {}
+
+        std::string path;           /*< absolute; empty in .total >*/
+        uint64_t    bytes;
+        uint64_t    wall_ns;
+        uint64_t    self_ns;
+        uint64_t    kwargs;
+        uint64_t    sections;
+        uint64_t    vectors;
+        uint64_t    macro_expansions;
+        uint64_t    trie_lookups;
+        unsigned    include_depth;  /*< 0 for the root >*/
+    };
+
+    std::vector<file> files;
+    file total;
+};
+
 /**
  * @class config
  * The config class is a specialized config_section identifying the 'root' of the config
@@ -371,13 +1076,93 @@ private:
  */
 class config : public config_section {
 public:
+    /**
+     * Flags which may be or'd together and passed at construction to alter how the
+     * hierarchy is loaded.
+     *
+     * LOAD_MMAP
+     *  Files (including every @include) are mapped read-only and parsed in place rather
+     *  than being copied into an intermediate buffer.
+     *
+     * LOAD_ARENA
+     *  The entire kwarg tree is built inside a monotonic arena owned by the config.
+     *  Parsing performs a handful of large allocations and destruction is O(1).
+     *
+     * LOAD_COMPILED
+     *  The file is a binary snapshot written by config::compile (or the cfgc tool)
+     *  rather than config text.  It is mapped and the tree rebuilt without lexing.
+     *
+     * LOAD_PARALLEL
+     *  @include targets are read and parsed into detached subtrees on a pool of worker
+     *  threads and spliced in, in order, before the including section is next touched.
+     *  Files which contain macros of their own are parsed in place once reached.  The
+     *  resulting hierarchy and macro registers are identical to a sequential load.
+     *
+     * LOAD_CACHE_INCLUDES
+     *  Each @include target is parsed once per distinct set of macro values it reads;
+     *  including it again splices the cached subtree and replays any macros it defined.
+     *  With LOAD_ARENA the subtree is shared between every section which includes it (and
+     *  copied on write should a later definition extend it), otherwise it is copied.  A
+     *  config_handle keeps the cache between reloads so that only changed files, and the
+     *  files which depend on them, are parsed again.
+     *
+     * LOAD_LAZY
+     *  The load only brace matches the body of each section and records where it is, and
+     *  the macros it can see; the section is parsed the first time one of its children
+     *  is read, so the cost of a load follows what is read rather than the size of the
+     *  files.  Bodies holding an @ statement are parsed in place.  The text of every file
+     *  with a deferred body is kept for the life of the config (read, never mapped, so
+     *  that editing the file after the load does not change it), and an error in a body
+     *  is thrown by each read of its section rather than by the constructor.  Ignored
+     *  with LOAD_PARALLEL or LOAD_CACHE_INCLUDES.
+     */
+    enum LOAD_FLAGS { LOAD_DEFAULT        = 0
+                    , LOAD_MMAP           = 1 << 0
+                    , LOAD_ARENA          = 1 << 1
+                    , LOAD_COMPILED       = 1 << 2
+                    , LOAD_PARALLEL       = 1 << 3
+                    , LOAD_CACHE_INCLUDES = 1 << 4
+                    , LOAD_LAZY           = 1 << 5 };
+
 #if defined(CONFIG_SINGLETON)
     static constexpr bool has_singleton = true;
-    static config* initialize(const std::string& file_path);
+    static config* initialize(const std::string& file_path, int flags = LOAD_DEFAULT);
     static config* instance();
 #else
     static constexpr bool has_singleton = false;
 #endif
+
+    ///{@
+    /**
+     * Binary snapshots.  compile(...) writes the loaded hierarchy, with every @include
+     * and macro already resolved, to file_path; the file is written beside its final
+     * name and renamed into place so readers never observe a partial snapshot.
+     *
+     * load_compiled(...) is a shorthand for LOAD_COMPILED | LOAD_ARENA.  With
+     * CONFIG_SINGLETON it initializes the singleton, otherwise the caller owns the
+     * returned config.
+     *
+     * Snapshots are tied to the byte order of the machine which wrote them and to the
+     * format version of the library; either mismatch is reported as a parse error.
+     *
+     * @throw config_io_error
+     * @throw config_parse_exception
+     */
+    void compile(const std::string& file_path) const;
+    static config* load_compiled(const std::string& file_path);
+    ///@}
+
+    /**
+     * Parses file_path (and everything it includes) into a sequence of events delivered
+     * to handler rather than into a hierarchy; no kwarg is allocated.  Of the flags only
+     * LOAD_MMAP applies.  @see config_handler (config-sax.hh)
+     *
+     * @return false if a callback stopped the parse
+     * @throw config_io_error
+     * @throw config_parse_exception
+     */
+    static bool stream(const std::string& file_path, config_handler& handler
+                     , int flags = LOAD_DEFAULT);
     /**
      * Tests down a hierarchy against a casting type.  This function should be used to
      * ensure types are being parsed correctly.
@@ -388,6 +1173,73 @@ public:
      */
     bool assert_type(const std::string& key, kwarg::TYPE type) const;
 
+    ///{@
+    /**
+     * Path based access from the root; @see config_section::resolve for the syntax.
+     *
+     * Resolved paths are memoized per config.  A repeated lookup costs one hash of the
+     * path and a compare against the cached record, which is read without locking.
+     *
+     * @throw config_key_error   also if the path names a section or a vector
+     */
+    template <typename _Tp>
+    CONFIG_ACCESSOR _Tp
+    get_path(kwarg_key path) const {
+        CONFIG_PROFILE_NOTE(ACCESS_GET_PATH, path);
+        const kwarg_const* ptr = _M_cached_value(path);
+
+        if (0x0 == ptr)
+            throw config_key_error(path.str());
+        else
+            return ptr->as<_Tp>();
+    }
+
+    template <typename _Tp>
+    CONFIG_ACCESSOR _Tp
+    get_path(kwarg_key path, const _Tp& deflt) const {
+        CONFIG_PROFILE_NOTE(ACCESS_GET_PATH, path);
+        const kwarg_const* ptr = _M_cached_value(path);
+
+        if (0x0 == ptr)
+            return deflt;
+        else
+            return ptr->as<_Tp>();
+    }
+
+    CONFIG_ACCESSOR bool has_path(kwarg_key path) const {
+        CONFIG_PROFILE_NOTE(ACCESS_HAS, path);
+        return 0x0 != _M_cached_resolve(path);
+    }
+    ///@}
+
+    /**
+     * Every file the hierarchy was loaded from, sorted by path; the root, each @include and
+     * each @include* whether or not it existed.  A change to any of them (and only to
+     * them) can change the result of loading the root again.
+     */
+    const std::vector<config_source>& sources() const
+    { return _M_sources; }
+
+    /// what the load cost; @see parse_stats
+    const parse_stats& stats() const
+    { return _M_stats; }
+
+    ///{@
+    /**
+     * Every key name of the hierarchy is interned once in its symbol table.  intern(...)
+     * returns the key of name bound to its symbol, which every section then looks up
+     * without hashing or comparing characters; a name which no key has is returned as
+     * it was given.
+     */
+    kwarg_key intern(kwarg_key name) const {
+        const config_symbol* symbol = _M_symbols->find(name.data(), name.size());
+        return symbol ? kwarg_key(*symbol) : name;
+    }
+
+    const symbol_table& symbols() const
+    { return *_M_symbols; }
+    ///@}
+
 #if defined(CONFIG_SINGLETON)
 private:
     static config* _S_instance;
@@ -397,10 +1249,91 @@ private:
      *
      * @throw config_parse_exception
      */
-    config(const std::string& file_path);
+    config(const std::string& file_path, int flags = LOAD_DEFAULT);
+
+public:
+    /**
+     * Not virtual, as no destructor of the hierarchy is, so that a config carries no vtable
+     * pointer either.  A config must be deleted as a config; deleting one through a
+     * config_section* is undefined.
+     */
+    ~config();
 
 private:
+    friend class config_handle;
+
+    /// loads with (and into) a cache of includes which outlives the config
+    config(const std::string& file_path, int flags, include_cache* cache);
+
+    /* declared before every other member, so that it is destroyed after all of them;
+     * ~config releases the tree, whose nodes name its symbols, before any member */
+    std::shared_ptr<symbol_table> _M_symbols;
+
+    ///{@
+    /**
+     * The path cache is a set associative table of immutable records; a path hashes to
+     * one set of PATH_WAYS slots, so that many hot paths can share a set.  Behind it every
+     * record is held in an open addressed table, which a path missing from its set probes
+     * next.  Readers of either only ever perform acquire loads.  Records are created (once
+     * per distinct path, and for at most PATH_RECORDS paths) under _M_path_lock; they, and
+     * every table the second level outgrows, live as long as the config.  Any further
+     * path is resolved without being cached.
+     */
+    enum { PATH_SETS = 64, PATH_WAYS = 4, PATH_RECORDS = 4096 };
+
+    struct path_record {
+        uint32_t     hash;
+        uint32_t     size;
+        const kwarg* ptr;
+
+        /// the characters of the path are stored directly after the record
+        const char* data() const
+        { return reinterpret_cast<const char*>(this + 1); }
+    };
+
+    struct path_table {
+        std::size_t mask;
+
+        /// the mask + 1 slots of the table are stored directly after it
+        std::atomic<const path_record*>* slots() const {
+            return reinterpret_cast<std::atomic<const path_record*>*>(
+                    const_cast<path_table*>(this) + 1);
+        }
+    };
+
+    const kwarg* _M_cached_resolve(kwarg_key path) const;
+
+    /// the value at path, or 0x0; @throw config_key_error if it is a section or vector
+    const kwarg_const*
+    _M_cached_value(kwarg_key path) const {
+        const kwarg* ptr = _M_cached_resolve(path);
+
+        if (0x0 != ptr
+         && (kwarg::SECTION == ptr->type() || kwarg::VECTOR == ptr->type()))
+            throw config_key_error(path.str());
+
+        return static_cast<const kwarg_const*>(ptr);
+    }
+
+    const kwarg* _M_cache_path(kwarg_key path, uint32_t hash) const;
+    const path_record* _M_find_path(kwarg_key path, uint32_t hash) const;
+    const path_record* _M_insert_path(kwarg_key path, uint32_t hash) const;
+    path_table* _M_new_path_table(std::size_t size) const;
+
+    mutable std::atomic<const path_record*> _M_path_slots[PATH_SETS * PATH_WAYS];
+    mutable std::atomic<const path_table*> _M_path_table;
+    mutable std::atomic<std::size_t> _M_path_count;
+    mutable std::atomic<std::size_t> _M_path_victim;
+    /* guarded by _M_path_lock: the creation of records and tables, from the arena */
+    mutable std::mutex _M_path_lock;
+    mutable config_arena _M_path_arena;
+    ///@}
+
     parse_trie<std::string> _M_macro_regs;
+    std::unique_ptr<config_arena> _M_arena;
+    std::vector<config_source> _M_sources;
+    std::unique_ptr<lazy_loader> _M_lazy_loader;
+    parse_stats _M_stats;
 };
 
 #endif //__CONFIG_HH_
@@ -68,8 +68,9 @@ new_section(config_section* cfg) {
 
     for (auto it  = cfg->cbegin(); it != cfg->cend(); ++it) {
         PyObject* tmp;
-        PyObject* name = PyString_FromString(it->first.c_str());
-        kwarg* ptr = it->second;
+        kwarg* ptr = *it;
+        const kwarg_key key = ptr->name();
+        PyObject* name = PyString_FromStringAndSize(key.data(), key.size());
 
         switch (ptr->type()) {
             case kwarg::UNDEFINED:
@@ -0,0 +1,293 @@
+/**
+ * @file config-cache.hh
+ *
+ * The parse of every included file kept for config::LOAD_CACHE_INCLUDES, together with
+ * what it was parsed from; shared by the parser and by config_handle, which keeps one
+ * cache across reloads.
+ */
+#ifndef __CONFIG_CACHE_HH_
+#define __CONFIG_CACHE_HH_
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "config.hh"
+#include "config-source.hh"
+
+
+/**
+ * A change to, or a read of, the macro registers made while parsing an include.
+ *
+ * LOOKUP
+ *  .token is the text following the '$' up to the end of the word; replaying the lookup
+ *  over it must consume the same length and yield the same value (or fail again,
+ *  .consumed == npos) for the parse to be reused.
+ *
+ * DEFINE
+ *  .token was defined as .value; it is applied again whenever the parse is reused.
+ *
+ * ENVIRON
+ *  @import read the environment variable .token as .value (unset, .consumed == npos).
+ */
+struct macro_dep {
+    enum KIND { LOOKUP
+              , DEFINE
+              , ENVIRON };
+
+    KIND        kind;
+    std::string token;
+    size_t      consumed;
+    std::string value;
+};
+
+/// everything the parse of one include depended on, in the order it happened
+struct include_record {
+    std::vector<macro_dep>      deps;
+    std::vector<config_source>  sources;    /*< the include and everything it included >*/
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @class include_cache
+ *
+ * Implements config::LOAD_CACHE_INCLUDES.  Every parse of an included file is kept,
+ * detached, under the absolute path of the file along with the record of what it read.
+ * A later include of the same path reuses the first variant for which:
+ *
+ *  o every file in .record.sources still hashes as it did when it was parsed, and
+ *  o every lookup still resolves the same way against the current registers (with the
+ *    variant's own definitions applied as they were made).
+ *
+ * Reusing a variant applies its definitions to the registers, so a file which @defines
+ * leaves exactly the registers it would have had it been parsed.
+ *
+ * A cache normally lives for a single load.  One which is kept between loads (eg: by
+ * config_handle) re-parses only the files which changed, the files which read a macro
+ * whose definition changed, and the files which include either; every other include
+ * is spliced from the previous load.  Variants which were not used by a load are dropped
+ * at the end of it.
+ *
+ * The cached subtrees are never modified.  With an arena each variant is built in an
+ * arena of its own which every arena sharing nodes out of it retains; sections spliced
+ * out of it are marked shared and copied before anything is added to them.
+ *
+ * Every config loaded with the cache interns its names in the cache's symbol table, so
+ * that a spliced subtree names its nodes with symbols of the config it is spliced into.
+ */
+class include_cache {
+public:
+    /// first block of the arena of a single variant; most includes are small
+    enum { BLOCK_SIZE = 4 * 1024 };
+
+    struct entry {
+        entry()
+            : root(0x0), last_load(0)
+        {}
+
+        ~entry() {
+            /* an arena backed subtree is released with the last arena retaining it */
+            if (root && ! arena)
+                delete root;
+        }
+
+        include_record                   record;
+        config_section*                  root;
+        std::shared_ptr<config_arena>    arena;
+        std::unordered_set<const kwarg*> replacing;
+        uint64_t                         last_load;
+
+        entry(const entry&) = delete;
+        entry& operator=(const entry&) = delete;
+    };
+
+    explicit include_cache(std::shared_ptr<symbol_table> symbols
+                               = std::make_shared<symbol_table>())
+        : _M_symbols(symbols), _M_load(0)
+    {}
+
+    /// the table of every config loaded with the cache
+    const std::shared_ptr<symbol_table>&
+    symbols() const {
+        return _M_symbols;
+    }
+
+    ///{@
+    /**
+     * Brackets one load.  Files are hashed at most once per load; end_load() drops every
+     * variant the load did not use.
+     */
+    void
+    begin_load() {
+        ++_M_load;
+        _M_seen.clear();
+    }
+
+    void
+    end_load() {
+        for (auto it = _M_entries.begin(); it != _M_entries.end(); ) {
+            std::vector<std::unique_ptr<entry>>& variants = it->second;
+            size_t kept = 0;
+
+            for (size_t n = 0; n < variants.size(); ++n)
+                if (_M_load == variants[n]->last_load)
+                    variants[kept++] = std::move(variants[n]);
+
+            variants.resize(kept);
+
+            if (variants.empty())
+                it = _M_entries.erase(it);
+            else
+                ++it;
+        }
+    }
+    ///@}
+
+    /// the state of source as read by the load in progress
+    void
+    note(const config_source& source) {
+        _M_seen[source.path] = source;
+    }
+
+    /// true if some variant of file_path has been cached
+    bool
+    contains(const std::string& file_path) const {
+        try {
+            return _M_entries.count(get_path_info(file_path).abspath);
+        } catch (const config_io_error&) {
+            return false;
+        }
+    }
+
+    const entry*
+    find(const std::string& abspath, const parse_trie<std::string>& regs) {
+        auto it = _M_entries.find(abspath);
+
+        if (it == _M_entries.end())
+            return 0x0;
+
+        for (auto e = it->second.begin(); e != it->second.end(); ++e) {
+            if (_M_current((*e)->record) && _S_valid((*e)->record, regs)) {
+                (*e)->last_load = _M_load;
+                return e->get();
+            }
+        }
+
+        return 0x0;
+    }
+
+    /// takes ownership of root (and arena), which must not be modified afterwards
+    const entry*
+    insert(const std::string& abspath, config_section* root
+         , const std::shared_ptr<config_arena>& arena, include_record& record
+         , std::unordered_set<const kwarg*>& replacing) {
+        std::unique_ptr<entry> e(new entry());
+        e->root      = root;
+        e->arena     = arena;
+        e->last_load = _M_load;
+        e->record.deps.swap(record.deps);
+        e->record.sources.swap(record.sources);
+        e->replacing.swap(replacing);
+
+        std::vector<std::unique_ptr<entry>>& variants = _M_entries[abspath];
+        variants.push_back(std::move(e));
+        return variants.back().get();
+    }
+
+    include_cache(const include_cache&) = delete;
+    include_cache& operator=(const include_cache&) = delete;
+
+private:
+    /// true if every file the record was parsed from is unchanged
+    bool
+    _M_current(const include_record& record) {
+        for (auto it = record.sources.begin(); it != record.sources.end(); ++it) {
+            auto seen = _M_seen.find(it->path);
+
+            if (seen == _M_seen.end()) {
+                config_source now;
+                now.path    = it->path;
+                now.present = false;
+                now.hash    = 0;
+
+                try {
+                    source_buffer source(it->path, true);
+                    now.present = true;
+                    now.hash    = content_hash(source.data(), source.size());
+                } catch (const config_io_error&) {
+                }
+
+                seen = _M_seen.insert(std::make_pair(it->path, now)).first;
+            }
+
+            if (seen->second.present != it->present || seen->second.hash != it->hash)
+                return false;
+        }
+
+        return true;
+    }
+
+    static bool
+    _S_valid(const include_record& record, const parse_trie<std::string>& regs) {
+        /* the registers are only copied if the record has definitions to replay */
+        std::unique_ptr<parse_trie<std::string>> scratch;
+        const parse_trie<std::string>* current = &regs;
+
+        for (auto it = record.deps.begin(); it != record.deps.end(); ++it) {
+            switch (it->kind) {
+                case macro_dep::DEFINE:
+                    if (! scratch) {
+                        scratch.reset(new parse_trie<std::string>(regs));
+                        current = scratch.get();
+                    }
+
+                    scratch->defval(it->token) = it->value;
+                    break;
+
+                case macro_dep::ENVIRON: {
+                    const char* value = getenv(it->token.c_str());
+
+                    if ((0x0 == value) != (std::string::npos == it->consumed)
+                     || (0x0 != value && it->value != value))
+                        return false;
+
+                    break;
+                }
+
+                case macro_dep::LOOKUP: {
+                    const char* token = it->token.data();
+                    _Iter iter(token, token + it->token.size());
+
+                    try {
+                        const std::string& value = current->lookup(iter);
+
+                        if (static_cast<size_t>(iter.base() - token) != it->consumed
+                         || value != it->value)
+                            return false;
+                    } catch (const trie_lookup_error&) {
+                        if (std::string::npos != it->consumed)
+                            return false;
+                    }
+
+                    break;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /* declared first, so that it outlives the cached subtrees */
+    std::shared_ptr<symbol_table> _M_symbols;
+    uint64_t _M_load;
+    std::unordered_map<std::string, config_source> _M_seen;
+    std::unordered_map<std::string, std::vector<std::unique_ptr<entry>>> _M_entries;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //__CONFIG_CACHE_HH_
@@ -0,0 +1,261 @@
+/**
+ * @file config-number.hh
+ *
+ * Numeric lexer used by parse_number.  Text is read in place from the input buffer and
+ * never copied onto the heap for the common cases.
+ *
+ *      integral    [+-]? digits
+ *                  [+-]? 0x hex-digits
+ *      floating    [+-]? digits? ('.' digits?)? ([eE] [+-]? digits)?
+ *
+ * A '_' may separate any two digits (1_000_000, 0xFF_FF).  Floating values whose
+ * significand fits in 53 bits and whose decimal exponent is within +/- 22 are computed
+ * exactly with a single multiply or divide; everything else is handed to strtod_l in the
+ * "C" locale so rounding is always correct.
+ */
+#ifndef __CONFIG_NUMBER_HH_
+#define __CONFIG_NUMBER_HH_
+
+#include <locale.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+
+namespace numeric {
+
+enum result {
+    VALID,
+    EMPTY,
+    MALFORMED,
+    OUT_OF_RANGE
+};
+
+struct value {
+    bool    integral;
+    int64_t i;
+    double  d;
+};
+
+/// characters which may appear anywhere in the text of a number
+inline bool
+is_number_char(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+        || '.' == c || '_' == c || '-' == c || '+' == c;
+}
+
+namespace detail {
+
+/// value of c as a digit in base 10 or 16, -1 if it is not one
+inline int
+digit_value(char c, int base) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    else if (16 != base)
+        return -1;
+    else if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    else
+        return -1;
+}
+
+/**
+ * Consumes digits of the given base separated by single '_' characters.  Returns the
+ * number of digits read or -1 if a separator is not surrounded by digits.
+ */
+template <typename _Fn>
+inline int
+read_digits(const char*& ptr, const char* end, int base, _Fn&& on_digit) {
+    int count = 0;
+
+    while (ptr != end) {
+        const int d = digit_value(*ptr, base);
+
+        if (d >= 0) {
+            on_digit(d);
+            ++count;
+            ++ptr;
+        } else if ('_' == *ptr) {
+            if (0 == count || ptr + 1 == end || digit_value(ptr[1], base) < 0)
+                return -1;
+
+            ++ptr;
+        } else {
+            break;
+        }
+    }
+
+    return count;
+}
+
+inline locale_t
+c_locale() {
+    static const locale_t loc = ::newlocale(LC_ALL_MASK, "C", static_cast<locale_t>(0));
+    return loc;
+}
+
+/// strtod_l over [first, last) with the separators removed
+inline result
+slow_floating(const char* first, const char* last, double& out) {
+    char  stack[64];
+    std::string heap;
+    char* buf = stack;
+
+    if (static_cast<size_t>(last - first) >= sizeof(stack)) {
+        heap.resize(last - first + 1);
+        buf = &heap[0];
+    }
+
+    char* dst = buf;
+
+    for (const char* ptr = first; ptr != last; ++ptr)
+        if ('_' != *ptr)
+            *dst++ = *ptr;
+
+    *dst = '\0';
+
+    char* stop;
+    errno = 0;
+    out   = ::strtod_l(buf, &stop, c_locale());
+
+    if (stop != dst)
+        return MALFORMED;
+    else if (ERANGE == errno && (out > 1.0 || out < -1.0))
+        return OUT_OF_RANGE;
+    else
+        return VALID;
+}
+
+} // ns detail
+
+/**
+ * Parses all of [first, last) as a single number.
+ *
+ * @complexity O(N)
+ */
+inline result
+lex(const char* first, const char* last, value& out) {
+    static const double _S_pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    if (first == last)
+        return EMPTY;
+
+    const char* ptr = first;
+    const bool  neg = ('-' == *ptr);
+
+    if ('-' == *ptr || '+' == *ptr)
+        ++ptr;
+
+    /* HEXADECIMAL */
+    if (last - ptr > 2 && '0' == ptr[0] && ('x' == ptr[1] || 'X' == ptr[1])) {
+        ptr += 2;
+        uint64_t mag = 0;
+        bool     big = false;
+
+        const int n = detail::read_digits(ptr, last, 16, [&](int d) {
+            big = big || (mag >> 60) != 0;
+            mag = (mag << 4) | static_cast<uint64_t>(d);
+        });
+
+        if (n <= 0 || ptr != last)
+            return MALFORMED;
+        else if (big || mag > static_cast<uint64_t>(INT64_MAX) + neg)
+            return OUT_OF_RANGE;
+
+        out.integral = true;
+        out.i        = neg ? static_cast<int64_t>(0 - mag) : static_cast<int64_t>(mag);
+        return VALID;
+    }
+
+    /* DECIMAL; the first 19 significant digits are accumulated exactly */
+    uint64_t mantissa = 0;
+    int      digits   = 0;   /*< significant digits seen, leading zeros excluded >*/
+    int      dropped  = 0;   /*< significant digits which did not fit in mantissa >*/
+    int      exp10    = 0;   /*< only meaningful while dropped == 0 >*/
+
+    auto on_digit = [&](int d) {
+        if (0 == digits && 0 == d)
+            return;
+
+        if (digits < 19)
+            mantissa = mantissa * 10 + static_cast<uint64_t>(d);
+        else
+            ++dropped;
+
+        ++digits;
+    };
+
+    const int whole = detail::read_digits(ptr, last, 10, on_digit);
+    int frac = 0;
+
+    if (whole < 0)
+        return MALFORMED;
+
+    bool integral = true;
+
+    if (ptr != last && '.' == *ptr) {
+        ++ptr;
+        integral = false;
+        frac     = detail::read_digits(ptr, last, 10, on_digit);
+
+        if (frac < 0)
+            return MALFORMED;
+
+        exp10 = -frac;
+    }
+
+    if (0 == whole + frac)
+        return MALFORMED;
+
+    if (ptr != last && ('e' == *ptr || 'E' == *ptr)) {
+        ++ptr;
+        integral = false;
+        bool eneg = false;
+
+        if (ptr != last && ('-' == *ptr || '+' == *ptr))
+            eneg = ('-' == *ptr++);
+
+        int explicit_exp = 0;
+        const int n = detail::read_digits(ptr, last, 10, [&](int d) {
+            if (explicit_exp < 100000)
+                explicit_exp = explicit_exp * 10 + d;
+        });
+
+        if (n <= 0)
+            return MALFORMED;
+
+        exp10 += eneg ? -explicit_exp : explicit_exp;
+    }
+
+    if (ptr != last)
+        return MALFORMED;
+
+    out.integral = integral;
+
+    if (integral) {
+        if (digits > 19 || mantissa > static_cast<uint64_t>(INT64_MAX) + neg)
+            return OUT_OF_RANGE;
+
+        out.i = neg ? static_cast<int64_t>(0 - mantissa) : static_cast<int64_t>(mantissa);
+        return VALID;
+    }
+
+    if (0 == dropped && mantissa <= (uint64_t(1) << 53) && exp10 >= -22 && exp10 <= 22) {
+        const double m = static_cast<double>(mantissa);
+        out.d = (exp10 < 0) ? m / _S_pow10[-exp10] : m * _S_pow10[exp10];
+        out.d = neg ? -out.d : out.d;
+        return VALID;
+    }
+
+    return detail::slow_floating(first, last, out.d);
+}
+
+} // ns numeric
+
+#endif //__CONFIG_NUMBER_HH_
@@ -0,0 +1,323 @@
+#include "config-profile.hh"
+#include "config-source.hh"
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <tuple>
+#include <unordered_set>
+
+
+using std::string;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+namespace {
+
+/// one accessor called for one key of one section from one call site
+struct site {
+    const config_section*   section;
+    const void*             caller;
+    config_access           access;
+    uint64_t                key_hash;
+
+    bool operator==(const site& rhs) const {
+        return section  == rhs.section && caller   == rhs.caller
+            && access   == rhs.access  && key_hash == rhs.key_hash;
+    }
+};
+
+struct site_hash {
+    size_t operator()(const site& s) const {
+        return s.key_hash
+             ^ (reinterpret_cast<uintptr_t>(s.section) * 0x9E3779B97F4A7C15ull)
+             ^ (reinterpret_cast<uintptr_t>(s.caller)  * 0xC4CEB9FE1A85EC53ull)
+             ^ s.access;
+    }
+};
+
+struct site_count {
+    string      key;
+    uint64_t    calls;
+};
+
+/// the calls counted on one thread
+struct profile_table {
+    std::mutex                                      lock;
+    std::unordered_map<site, site_count, site_hash> sites;
+};
+
+/// calls made on a section which has since been destroyed, by its qualified key
+typedef std::tuple<config_access, string, const void*> settled_key;
+
+struct profile_registry {
+    profile_registry()
+        : exit_top_n(20)
+    {}
+
+    std::mutex                                  lock;
+    std::vector<std::unique_ptr<profile_table>> tables;
+    std::unordered_set<const config*>           roots;
+    std::map<settled_key, uint64_t>             settled;
+    size_t                                      exit_top_n;
+};
+
+/// never destructed, as threads may still look keys up while the process exits
+profile_registry&
+registry() {
+    static profile_registry* instance = new profile_registry();
+    return *instance;
+}
+
+/// the table of the calling thread; it outlives the thread
+profile_table&
+thread_table() {
+    static thread_local profile_table* table = 0x0;
+
+    if (0x0 == table) {
+        profile_registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.lock);
+
+        reg.tables.emplace_back(new profile_table());
+        table = reg.tables.back().get();
+    }
+
+    return *table;
+}
+
+/// the fully qualified key of key in the section at path
+string
+qualify(const std::unordered_map<const config_section*, string>& paths
+      , const config_section* section, const string& key) {
+    auto it = paths.find(section);
+
+    if (paths.end() == it)
+        return "?." + key;
+    else if (it->second.empty())
+        return key;
+    else
+        return it->second + "." + key;
+}
+
+/// function+offset [object+offset] of the call which returns to caller
+string
+symbolize(const void* caller) {
+    /* the call instruction itself ends at the return address */
+    const char* call = static_cast<const char*>(caller) - 1;
+    std::stringstream out;
+    Dl_info info;
+
+    if (0 == dladdr(call, &info)) {
+        out << caller;
+        return out.str();
+    }
+
+    if (info.dli_sname) {
+        int status = 0;
+        char* name = abi::__cxa_demangle(info.dli_sname, 0x0, 0x0, &status);
+
+        out << (0 == status ? name : info.dli_sname) << "+0x" << std::hex
+            << (call + 1 - static_cast<const char*>(info.dli_saddr)) << " ";
+        free(name);
+    }
+
+    const char* object = info.dli_fname ? info.dli_fname : "?";
+    out << "[" << object << "+0x" << std::hex
+        << (call + 1 - static_cast<const char*>(info.dli_fbase)) << "]";
+    return out.str();
+}
+
+void
+report_atexit() {
+    config_profile::report(std::cerr, registry().exit_top_n);
+}
+
+} // ns
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void
+config_profile_note(const config_section* section, kwarg_key key, config_access access
+                  , const void* caller) {
+    profile_table& table = thread_table();
+    const site s = { section, caller, access, content_hash(key.data(), key.size()) };
+
+    std::lock_guard<std::mutex> lock(table.lock);
+    auto it = table.sites.find(s);
+
+    if (table.sites.end() == it) {
+        site_count count;
+        count.key   = key.str();
+        count.calls = 0;
+        it = table.sites.insert(std::make_pair(s, count)).first;
+    }
+
+    ++it->second.calls;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+std::vector<config_profile::entry>
+config_profile::top(size_t top_n) {
+    profile_registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.lock);
+
+    path_map paths;
+
+    for (auto it = reg.roots.begin(); it != reg.roots.end(); ++it)
+        _S_paths(*it, "", paths);
+
+    std::map<settled_key, uint64_t> all(reg.settled);
+
+    for (auto t = reg.tables.begin(); t != reg.tables.end(); ++t) {
+        std::lock_guard<std::mutex> table_lock((*t)->lock);
+
+        for (auto it = (*t)->sites.begin(); it != (*t)->sites.end(); ++it) {
+            const settled_key key(it->first.access
+                                , qualify(paths, it->first.section, it->second.key)
+                                , it->first.caller);
+            all[key] += it->second.calls;
+        }
+    }
+
+    std::vector<entry> entries;
+
+    for (auto it = all.begin(); it != all.end(); ++it) {
+        entry e;
+        e.access = std::get<0>(it->first);
+        e.key    = std::get<1>(it->first);
+        e.caller = std::get<2>(it->first);
+        e.calls  = it->second;
+        entries.push_back(e);
+    }
+
+    /* ties keep the order of the key */
+    std::stable_sort(entries.begin(), entries.end(), [](const entry& lhs, const entry& rhs) {
+        return lhs.calls > rhs.calls;
+    });
+
+    if (top_n && entries.size() > top_n)
+        entries.resize(top_n);
+
+    return entries;
+}
+
+void
+config_profile::report(std::ostream& out, size_t top_n) {
+    const std::vector<entry> entries = top(top_n);
+
+    out << std::setw(14) << "calls" << "  " << std::left << std::setw(14) << "accessor"
+        << std::setw(40) << "key" << " caller" << std::right << "\n";
+
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        out << std::setw(14) << it->calls << "  " << std::left
+            << std::setw(14) << access_name(it->access)
+            << std::setw(40) << it->key << " " << symbolize(it->caller)
+            << std::right << "\n";
+    }
+
+    out << std::flush;
+}
+
+void
+config_profile::report_at_exit(size_t top_n) {
+    static std::once_flag once;
+    profile_registry& reg = registry();
+
+    {
+        std::lock_guard<std::mutex> lock(reg.lock);
+        reg.exit_top_n = top_n;
+    }
+
+    std::call_once(once, []() { ::atexit(report_atexit); });
+}
+
+void
+config_profile::reset() {
+    profile_registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.lock);
+
+    reg.settled.clear();
+
+    for (auto t = reg.tables.begin(); t != reg.tables.end(); ++t) {
+        std::lock_guard<std::mutex> table_lock((*t)->lock);
+        (*t)->sites.clear();
+    }
+}
+
+const char*
+config_profile::access_name(config_access access) {
+    switch (access) {
+        case ACCESS_GET:            return "get";
+        case ACCESS_GET_DEFAULT:    return "get(default)";
+        case ACCESS_SECTION:        return "section";
+        case ACCESS_VECTOR:         return "vector";
+        case ACCESS_HAS:            return "has";
+        case ACCESS_GET_PATH:       return "get_path";
+    }
+
+    return "?";
+}
+
+void
+config_profile::_S_attach(const config* root) {
+    profile_registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.lock);
+    reg.roots.insert(root);
+}
+
+void
+config_profile::_S_detach(const config* root) {
+    profile_registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.lock);
+
+    if (0 == reg.roots.erase(root))
+        return;
+
+    /* the calls on its sections are kept by key, as the sections are about to go */
+    path_map paths;
+    _S_paths(root, "", paths);
+
+    for (auto t = reg.tables.begin(); t != reg.tables.end(); ++t) {
+        std::lock_guard<std::mutex> table_lock((*t)->lock);
+
+        for (auto it = (*t)->sites.begin(); it != (*t)->sites.end(); ) {
+            if (paths.count(it->first.section)) {
+                const settled_key key(it->first.access
+                                    , qualify(paths, it->first.section, it->second.key)
+                                    , it->first.caller);
+                reg.settled[key] += it->second.calls;
+                it = (*t)->sites.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+void
+config_profile::_S_paths(const config_section* section, const string& path
+                       , path_map& paths) {
+    /* a shared section keeps the first of its paths */
+    if (! paths.insert(std::make_pair(section, path)).second)
+        return;
+
+    /* the children of a lazy section which is yet to be built were never looked up */
+    if (section->_M_lazy.load(std::memory_order_acquire))
+        return;
+
+    for (auto it = section->_M_kwargs.begin(); it != section->_M_kwargs.end(); ++it) {
+        if (kwarg::SECTION != (*it)->type())
+            continue;
+
+        const string name = (*it)->name();
+        _S_paths(static_cast<const config_section*>(*it)
+               , path.empty() ? name : path + "." + name, paths);
+    }
+}
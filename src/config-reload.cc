@@ -0,0 +1,80 @@
+#include "config-reload.hh"
+#include "config-cache.hh"
+
+#include <thread>
+
+
+using std::string;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+namespace {
+
+/// spins until every reader inside the window has left it
+void
+wait_empty(const std::atomic<uint64_t>& count) {
+    while (0 != count.load(std::memory_order_seq_cst))
+        std::this_thread::yield();
+}
+
+} // ns
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+config_handle::config_handle(const string& file_path, int flags)
+    : _M_path(file_path)
+    , _M_flags(flags)
+    , _M_cache((flags & config::LOAD_CACHE_INCLUDES) ? new include_cache() : 0x0)
+    , _M_current(new snapshot(_S_load(file_path, flags, _M_cache.get())))
+    , _M_epoch(0)
+    , _M_generation(1)
+{
+    _M_readers[0].count.store(0, std::memory_order_relaxed);
+    _M_readers[1].count.store(0, std::memory_order_relaxed);
+}
+
+config_handle::~config_handle() {
+    delete _M_current.load(std::memory_order_acquire);
+}
+
+config_handle::snapshot
+config_handle::acquire() const {
+    /* the window keeps the pointer which is loaded below from being retired until the
+     * snapshot it points at has been copied */
+    const uint64_t window = _M_epoch.load(std::memory_order_seq_cst) & 1;
+    _M_readers[window].count.fetch_add(1, std::memory_order_seq_cst);
+
+    snapshot current = *_M_current.load(std::memory_order_seq_cst);
+
+    _M_readers[window].count.fetch_sub(1, std::memory_order_release);
+    return current;
+}
+
+void
+config_handle::reload() {
+    /* parsed under the lock so that a slow reload can not publish over a later one */
+    std::lock_guard<std::mutex> lock(_M_reload_lock);
+    std::unique_ptr<const snapshot> next(
+            new snapshot(_S_load(_M_path, _M_flags, _M_cache.get())));
+
+    const snapshot* prev = _M_current.exchange(next.release()
+                                             , std::memory_order_seq_cst);
+    _M_generation.fetch_add(1, std::memory_order_release);
+
+    /* a reader may have entered either window before the exchange; the window of the
+     * previous epoch is emptied first, then readers are turned towards it and the window
+     * of the current epoch is emptied */
+    const uint64_t epoch = _M_epoch.load(std::memory_order_relaxed);
+    wait_empty(_M_readers[(epoch + 1) & 1].count);
+    _M_epoch.store(epoch + 1, std::memory_order_seq_cst);
+    wait_empty(_M_readers[epoch & 1].count);
+
+    /* drops the handle's reference; readers still holding the old tree keep it alive */
+    delete prev;
+}
+
+config_handle::snapshot
+config_handle::_S_load(const string& file_path, int flags, include_cache* cache) {
+    return snapshot(new config(file_path, flags, cache));
+}
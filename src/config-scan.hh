@@ -0,0 +1,266 @@
+/**
+ * @file config-scan.hh
+ *
+ * Block scanners used by the lexer.  Each function returns the first position in
+ * [ptr, end) which satisfies some predicate (or end) while inspecting 32 (AVX2) or 16
+ * (SSE2) bytes per step.  The vector loops never read past end so they are safe on an
+ * mmap'd buffer; the remaining tail is handled one byte at a time.
+ *
+ * The AVX2 path is chosen at compile time (eg: -mavx2 / -march=native), SSE2 is part of
+ * the x86-64 baseline and anything else falls back to the scalar loops.
+ */
+#ifndef __CONFIG_SCAN_HH_
+#define __CONFIG_SCAN_HH_
+
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#  include <immintrin.h>
+#endif
+
+#include "config-bits.hh"
+
+
+namespace scan {
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// SCALAR PREDICATES
+//////////////////////////////////////////////////////////////////////////////////////////
+/// whitespace in the "C" locale
+inline bool
+is_space(char c) {
+    return ' ' == c || (c >= '\t' && c <= '\r');
+}
+
+/// characters which need a decision inside of a string; everything else is copied
+inline bool
+is_string_special(char c) {
+    return '\'' == c || '"' == c || '$' == c || '\0' == c;
+}
+
+/// characters which need a decision while skipping a section body; @see LOAD_LAZY
+inline bool
+is_body_special(char c) {
+    return '{' == c || '}' == c || '\'' == c || '"' == c || '/' == c || '@' == c
+        || '$' == c || '\0' == c;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// BLOCK PREDICATES
+//////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Each block predicate returns a bitmask with bit i set if byte i of the block does
+ * /not/ belong to the run being skipped; the first such byte is found with ctz.
+ */
+#if defined(__AVX2__)
+typedef __m256i block_type;
+enum { BLOCK_SIZE = 32 };
+static const unsigned BLOCK_BITS = 0xFFFFFFFFu;
+
+inline block_type block_load(const char* p)
+{ return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+
+inline block_type block_set(char c)
+{ return _mm256_set1_epi8(c); }
+
+inline block_type block_eq(block_type a, block_type b)
+{ return _mm256_cmpeq_epi8(a, b); }
+
+inline block_type block_gt(block_type a, block_type b)
+{ return _mm256_cmpgt_epi8(a, b); }
+
+inline block_type block_or(block_type a, block_type b)
+{ return _mm256_or_si256(a, b); }
+
+inline block_type block_and(block_type a, block_type b)
+{ return _mm256_and_si256(a, b); }
+
+inline unsigned block_mask(block_type a)
+{ return static_cast<unsigned>(_mm256_movemask_epi8(a)); }
+
+#elif defined(__SSE2__)
+typedef __m128i block_type;
+enum { BLOCK_SIZE = 16 };
+static const unsigned BLOCK_BITS = 0xFFFFu;
+
+inline block_type block_load(const char* p)
+{ return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+
+inline block_type block_set(char c)
+{ return _mm_set1_epi8(c); }
+
+inline block_type block_eq(block_type a, block_type b)
+{ return _mm_cmpeq_epi8(a, b); }
+
+inline block_type block_gt(block_type a, block_type b)
+{ return _mm_cmpgt_epi8(a, b); }
+
+inline block_type block_or(block_type a, block_type b)
+{ return _mm_or_si128(a, b); }
+
+inline block_type block_and(block_type a, block_type b)
+{ return _mm_and_si128(a, b); }
+
+inline unsigned block_mask(block_type a)
+{ return static_cast<unsigned>(_mm_movemask_epi8(a)); }
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+# define CONFIG_SCAN_BLOCKS 1
+
+/// block_gt is a signed compare; every range below lies within [0x00, 0x7F]
+inline block_type
+block_in_range(block_type x, char lo, char hi) {
+    return block_and(block_gt(x, block_set(lo - 1)), block_gt(block_set(hi + 1), x));
+}
+
+inline unsigned
+block_not_space(const char* p) {
+    const block_type x = block_load(p);
+    const block_type m = block_or(block_eq(x, block_set(' '))
+                                , block_in_range(x, '\t', '\r'));
+    return ~block_mask(m) & BLOCK_BITS;
+}
+
+inline unsigned
+block_not_word(const char* p) {
+    const block_type x = block_load(p);
+    block_type m = block_in_range(x, '0', '9');
+    m = block_or(m, block_in_range(x, 'A', 'Z'));
+    m = block_or(m, block_in_range(x, 'a', 'z'));
+    m = block_or(m, block_eq(x, block_set('_')));
+    m = block_or(m, block_eq(x, block_set('*')));
+    return ~block_mask(m) & BLOCK_BITS;
+}
+
+inline unsigned
+block_string_special(const char* p) {
+    const block_type x = block_load(p);
+    block_type m = block_eq(x, block_set('\''));
+    m = block_or(m, block_eq(x, block_set('"')));
+    m = block_or(m, block_eq(x, block_set('$')));
+    m = block_or(m, block_eq(x, block_set('\0')));
+    return block_mask(m);
+}
+
+inline unsigned
+block_body_special(const char* p) {
+    const block_type x = block_load(p);
+    block_type m = block_eq(x, block_set('{'));
+    m = block_or(m, block_eq(x, block_set('}')));
+    m = block_or(m, block_eq(x, block_set('\'')));
+    m = block_or(m, block_eq(x, block_set('"')));
+    m = block_or(m, block_eq(x, block_set('/')));
+    m = block_or(m, block_eq(x, block_set('@')));
+    m = block_or(m, block_eq(x, block_set('$')));
+    m = block_or(m, block_eq(x, block_set('\0')));
+    return block_mask(m);
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// SCANNERS
+//////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Runs are usually short (a single space, a six character key) so each scanner checks
+ * the first byte before paying for a block load.
+ */
+#if defined(CONFIG_SCAN_BLOCKS)
+# define CONFIG_SCAN_LOOP(_ptr_, _end_, _block_)                                        \
+    while ((_end_) - (_ptr_) >= BLOCK_SIZE) {                                            \
+        const unsigned mask = (_block_)(_ptr_);                                          \
+                                                                                         \
+        if (0 != mask)                                                                   \
+            return (_ptr_) + __builtin_ctz(mask);                                        \
+                                                                                         \
+        (_ptr_) += BLOCK_SIZE;                                                           \
+    }
+#else
+# define CONFIG_SCAN_LOOP(_ptr_, _end_, _block_)
+#endif
+
+/// first position which is not whitespace
+inline const char*
+skip_space(const char* ptr, const char* end) {
+    if (ptr == end || ! is_space(*ptr))
+        return ptr;
+
+    CONFIG_SCAN_LOOP(ptr, end, block_not_space)
+
+    while (ptr != end && is_space(*ptr))
+        ++ptr;
+
+    return ptr;
+}
+
+/// first position which is not an acceptable_char
+inline const char*
+skip_word(const char* ptr, const char* end) {
+    if (ptr == end || ! acceptable_char(*ptr))
+        return ptr;
+
+    CONFIG_SCAN_LOOP(ptr, end, block_not_word)
+
+    while (ptr != end && acceptable_char(*ptr))
+        ++ptr;
+
+    return ptr;
+}
+
+/// first quote, '$' or NUL
+inline const char*
+find_string_special(const char* ptr, const char* end) {
+    if (ptr == end || is_string_special(*ptr))
+        return ptr;
+
+    CONFIG_SCAN_LOOP(ptr, end, block_string_special)
+
+    while (ptr != end && ! is_string_special(*ptr))
+        ++ptr;
+
+    return ptr;
+}
+
+/// first brace, quote, '/', '@', '$' or NUL
+inline const char*
+find_body_special(const char* ptr, const char* end) {
+    if (ptr == end || is_body_special(*ptr))
+        return ptr;
+
+    CONFIG_SCAN_LOOP(ptr, end, block_body_special)
+
+    while (ptr != end && ! is_body_special(*ptr))
+        ++ptr;
+
+    return ptr;
+}
+
+/// the '*' of the first "*/" or 0x0; libc's memchr is already vectorized
+inline const char*
+find_comment_end(const char* ptr, const char* end) {
+    while (ptr < end) {
+        ptr = static_cast<const char*>(std::memchr(ptr, '*', end - ptr));
+
+        if (0x0 == ptr || ptr + 1 >= end)
+            return 0x0;
+        else if ('/' == ptr[1])
+            return ptr;
+
+        ++ptr;
+    }
+
+    return 0x0;
+}
+
+/// the first '\n' or end
+inline const char*
+find_line_end(const char* ptr, const char* end) {
+    const void* eol = std::memchr(ptr, '\n', end - ptr);
+    return eol ? static_cast<const char*>(eol) : end;
+}
+
+#undef CONFIG_SCAN_LOOP
+
+} // ns scan
+
+#endif //__CONFIG_SCAN_HH_
@@ -0,0 +1,437 @@
+#include "config-snapshot.hh"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+
+using std::string;
+
+const char SNAPSHOT_MAGIC[8] = { 'C', 'F', 'G', 'S', 'N', 'A', 'P', '\0' };
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+namespace {
+
+/**
+ * @class snapshot_writer
+ *
+ * Flattens a hierarchy breadth first.  Names and string values are interned so a key
+ * repeated across many sections is stored once.  A packed vector is copied whole into the
+ * data region rather than written a node per element.
+ */
+class snapshot_writer {
+public:
+    explicit snapshot_writer(const config_section& root) {
+        _M_refs.push_back(&root);
+        _M_nodes.push_back(_M_record(&root));
+
+        /* _M_refs grows while it is walked; every appended child is visited in turn */
+        for (size_t i = 0; i < _M_refs.size(); ++i) {
+            const kwarg* ptr = _M_refs[i];
+
+            if (kwarg::SECTION == ptr->type()) {
+                const config_section* sec = static_cast<const config_section*>(ptr);
+                _M_nodes[i].value.index = _M_nodes.size();
+                _M_nodes[i].size        = sec->size();
+
+                for (auto it = sec->cbegin(); it != sec->cend(); ++it)
+                    _M_append(*it);
+            } else if (kwarg::VECTOR == _M_nodes[i].type) {
+                const kwarg_vector& vec = *static_cast<const kwarg_vector*>(ptr);
+                _M_nodes[i].value.index = _M_nodes.size();
+                _M_nodes[i].size        = vec.size();
+
+                for (auto it = vec->cbegin(); it != vec->cend(); ++it)
+                    _M_append(*it);
+            }
+        }
+    }
+
+    void
+    write(const string& file_path) const {
+        snapshot_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+
+        header.version       = SNAPSHOT_VERSION;
+        header.byte_order    = SNAPSHOT_BYTE_ORDER;
+        header.node_count    = _M_nodes.size();
+        header.node_offset   = sizeof(header);
+        header.data_offset   = header.node_offset
+                             + _M_nodes.size() * sizeof(snapshot_node);
+        header.data_size     = _M_data.size();
+        header.string_offset = header.data_offset + header.data_size;
+        header.string_size   = _M_strings.size();
+        header.file_size     = header.string_offset + header.string_size;
+
+        /* written beside the target and renamed over it so a process mapping the old
+         * snapshot keeps a consistent view */
+        const string temp_path = file_path + ".tmp." + std::to_string(::getpid());
+        const int fd = ::open(temp_path.c_str()
+                            , O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+        if (fd < 0)
+            throw config_io_error(file_path);
+
+        const bool ok = _S_write(fd, &header, sizeof(header))
+                     && _S_write(fd, _M_nodes.data()
+                               , _M_nodes.size() * sizeof(snapshot_node))
+                     && _S_write(fd, _M_data.data(), _M_data.size())
+                     && _S_write(fd, _M_strings.data(), _M_strings.size());
+
+        if (0 != ::close(fd)
+         || ! ok
+         || 0 != ::rename(temp_path.c_str(), file_path.c_str())) {
+            ::unlink(temp_path.c_str());
+            throw config_io_error(file_path);
+        }
+    }
+
+private:
+    static bool
+    _S_write(int fd, const void* data, size_t size) {
+        const char* ptr = static_cast<const char*>(data);
+
+        while (size > 0) {
+            const ssize_t rc = ::write(fd, ptr, size);
+
+            if (rc < 0)
+                return false;
+
+            ptr  += rc;
+            size -= static_cast<size_t>(rc);
+        }
+
+        return true;
+    }
+
+    static const kwarg_const*
+    _S_value(const kwarg* ptr)
+    { return static_cast<const kwarg_const*>(ptr); }
+
+    void
+    _M_append(const kwarg* ptr) {
+        _M_refs.push_back(ptr);
+        _M_nodes.push_back(_M_record(ptr));
+    }
+
+    uint64_t
+    _M_intern(const string& str) {
+        auto it = _M_offsets.find(str);
+
+        if (it != _M_offsets.end())
+            return it->second;
+
+        const uint64_t offset = _M_strings.size();
+        _M_strings.append(str);
+        _M_offsets.emplace(str, offset);
+        return offset;
+    }
+
+    /// appends size bytes to the data region, padded to keep the next vector aligned
+    uint64_t
+    _M_append_data(const void* data, size_t size) {
+        const uint64_t offset = _M_data.size();
+        _M_data.append(static_cast<const char*>(data), size);
+        _M_data.resize((_M_data.size() + 7) & ~size_t(7), '\0');
+        return offset;
+    }
+
+    snapshot_node
+    _M_record(const kwarg* ptr) {
+        snapshot_node node;
+        memset(&node, 0, sizeof(node));
+
+        const string name = ptr->name();
+        node.type         = ptr->type();
+        node.name_size    = name.size();
+        node.name_offset  = _M_intern(name);
+
+        switch (ptr->type()) {
+            case kwarg::BOOL:
+                node.value.boolean = _S_value(ptr)->as<bool>() ? 1 : 0;
+                break;
+
+            case kwarg::INTEGRAL:
+                node.value.integral = _S_value(ptr)->as<int64_t>();
+                break;
+
+            case kwarg::FLOATING:
+                node.value.floating = _S_value(ptr)->as<double>();
+                break;
+
+            case kwarg::STRING: {
+                const string str  = _S_value(ptr)->as<string>();
+                node.value.offset = _M_intern(str);
+                node.size         = str.size();
+                break;
+            }
+
+            case kwarg::VECTOR: {
+                const kwarg_vector& vec = *static_cast<const kwarg_vector*>(ptr);
+                node.size = vec.size();
+
+                switch (vec.value_type()) {
+                    case kwarg::INTEGRAL: {
+                        const config_span<int64_t> span = vec.span<int64_t>();
+                        node.type         = SNAPSHOT_PACKED_INTEGRAL;
+                        node.value.offset = _M_append_data(span.data()
+                                                         , span.size() * sizeof(int64_t));
+                        break;
+                    }
+
+                    case kwarg::FLOATING: {
+                        const config_span<double> span = vec.span<double>();
+                        node.type         = SNAPSHOT_PACKED_FLOATING;
+                        node.value.offset = _M_append_data(span.data()
+                                                         , span.size() * sizeof(double));
+                        break;
+                    }
+
+                    case kwarg::BOOL: {
+                        const config_span<bool> span = vec.span<bool>();
+                        node.type         = SNAPSHOT_PACKED_BOOL;
+                        node.value.offset = _M_append_data(span.data()
+                                                         , span.size() * sizeof(bool));
+                        break;
+                    }
+
+                    default:
+                        /* the range of a vector which is not packed is assigned once its
+                         * children are */
+                        break;
+                }
+
+                break;
+            }
+
+            default:
+                /* SECTION ranges are assigned once their children are */
+                break;
+        }
+
+        return node;
+    }
+
+    std::vector<const kwarg*>           _M_refs;
+    std::vector<snapshot_node>          _M_nodes;
+    string                              _M_data;
+    string                              _M_strings;
+    std::unordered_map<string, uint64_t> _M_offsets;
+};
+
+} // ns
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+snapshot_reader::snapshot_reader(const string& file_path)
+    : _M_path(file_path)
+    , _M_source(new source_buffer(file_path, true))
+    , _M_nodes(0x0)
+    , _M_data(0x0)
+    , _M_strings(0x0)
+{
+    _M_validate();
+}
+
+void
+snapshot_reader::load(config_section& root, config_arena* arena
+                    , symbol_table& symbols) const {
+    const snapshot_node& node = _M_nodes[0];
+
+    for (uint64_t i = 0; i < node.size; ++i)
+        root._M_set_kwarg(_M_build(node.value.index + i, arena, symbols));
+}
+
+void
+snapshot_reader::_M_validate() {
+    auto invalid = [this](const char* reason) {
+        return config_parse_exception("invalid snapshot [" + _M_path + "]: " + reason);
+    };
+
+    const char* base = _M_source->data();
+    const uint64_t size = _M_source->size();
+
+    if (size < sizeof(snapshot_header))
+        throw invalid("truncated header");
+
+    const snapshot_header* header = reinterpret_cast<const snapshot_header*>(base);
+
+    if (0 != memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)))
+        throw invalid("bad magic");
+    else if (header->version != SNAPSHOT_VERSION)
+        throw invalid("unsupported version");
+    else if (header->byte_order != SNAPSHOT_BYTE_ORDER)
+        throw invalid("written with a different byte order");
+    else if (header->file_size != size)
+        throw invalid("truncated");
+
+    if (header->node_offset < sizeof(snapshot_header)
+     || header->node_offset > size
+     || 0 != header->node_offset % alignof(snapshot_node)
+     || header->node_count > (size - header->node_offset) / sizeof(snapshot_node)
+     || 0 == header->node_count)
+        throw invalid("bad node table");
+
+    if (header->data_offset > size
+     || 0 != header->data_offset % alignof(int64_t)
+     || header->data_size > size - header->data_offset)
+        throw invalid("bad data region");
+
+    if (header->string_offset > size
+     || header->string_size > size - header->string_offset)
+        throw invalid("bad string pool");
+
+    const snapshot_node* nodes = reinterpret_cast<const snapshot_node*>(
+                                    base + header->node_offset);
+    const char* data = base + header->data_offset;
+    const uint64_t strings = header->string_size;
+
+    if (kwarg::SECTION != nodes[0].type)
+        throw invalid("root is not a section");
+
+    /* child ranges must tile [1, node_count) in order; this rules out cycles and nodes
+     * which are shared between two parents */
+    uint64_t next = 1;
+
+    for (uint64_t i = 0; i < header->node_count; ++i) {
+        const snapshot_node& node = nodes[i];
+
+        if (node.name_offset > strings || node.name_size > strings - node.name_offset)
+            throw invalid("bad name");
+
+        switch (node.type) {
+            case kwarg::BOOL:
+            case kwarg::INTEGRAL:
+            case kwarg::FLOATING:
+                break;
+
+            case kwarg::STRING:
+                if (node.value.offset > strings || node.size > strings - node.value.offset)
+                    throw invalid("bad string");
+                break;
+
+            case SNAPSHOT_PACKED_INTEGRAL:
+            case SNAPSHOT_PACKED_FLOATING:
+                if (0 == node.size
+                 || 0 != node.value.offset % alignof(int64_t)
+                 || node.value.offset > header->data_size
+                 || node.size > (header->data_size - node.value.offset) / sizeof(int64_t))
+                    throw invalid("bad packed vector");
+                break;
+
+            case SNAPSHOT_PACKED_BOOL:
+                if (0 == node.size
+                 || node.value.offset > header->data_size
+                 || node.size > header->data_size - node.value.offset)
+                    throw invalid("bad packed vector");
+
+                /* any other byte would not read back as a bool */
+                for (uint64_t n = 0; n < node.size; ++n)
+                    if (data[node.value.offset + n] & ~1)
+                        throw invalid("bad packed vector");
+                break;
+
+            case kwarg::SECTION:
+            case kwarg::VECTOR:
+                if (node.value.index != next
+                 || node.size > header->node_count - next)
+                    throw invalid("bad child range");
+
+                next += node.size;
+                break;
+
+            default:
+                throw invalid("bad type");
+        }
+    }
+
+    if (next != header->node_count)
+        throw invalid("unreferenced nodes");
+
+    _M_nodes   = nodes;
+    _M_data    = data;
+    _M_strings = base + header->string_offset;
+}
+
+string
+snapshot_reader::_M_string(uint64_t offset, uint64_t size) const {
+    return string(_M_strings + offset, size);
+}
+
+kwarg*
+snapshot_reader::_M_build(uint64_t index, config_arena* arena
+                        , symbol_table& symbols) const {
+    const snapshot_node& node = _M_nodes[index];
+    const config_symbol* name = symbols.intern(_M_strings + node.name_offset
+                                             , node.name_size);
+
+    switch (node.type) {
+        case kwarg::BOOL:
+            return new (arena) kwarg_const(0 != node.value.boolean, name, arena);
+
+        case kwarg::INTEGRAL:
+            return new (arena) kwarg_const(node.value.integral, name, arena);
+
+        case kwarg::FLOATING:
+            return new (arena) kwarg_const(node.value.floating, name, arena);
+
+        case kwarg::STRING:
+            return new (arena) kwarg_const(_M_string(node.value.offset, node.size)
+                                         , name, arena);
+
+        case SNAPSHOT_PACKED_INTEGRAL:
+            return new (arena) kwarg_vector(name, kwarg::INTEGRAL
+                                          , _M_data + node.value.offset, node.size, arena);
+
+        case SNAPSHOT_PACKED_FLOATING:
+            return new (arena) kwarg_vector(name, kwarg::FLOATING
+                                          , _M_data + node.value.offset, node.size, arena);
+
+        case SNAPSHOT_PACKED_BOOL:
+            return new (arena) kwarg_vector(name, kwarg::BOOL
+                                          , _M_data + node.value.offset, node.size, arena);
+
+        case kwarg::VECTOR: {
+            const kwarg_vector::vector_type::allocator_type alloc(arena);
+            kwarg_vector::vector_type items(alloc);
+            items.reserve(node.size);
+
+            for (uint64_t i = 0; i < node.size; ++i)
+                items.push_back(static_cast<kwarg_const*>(
+                        _M_build(node.value.index + i, arena, symbols)));
+
+            return new (arena) kwarg_vector(name, items, arena);
+        }
+
+        default: {
+            config_section* sec = new (arena) config_section(name, arena);
+
+            for (uint64_t i = 0; i < node.size; ++i)
+                sec->_M_set_kwarg(_M_build(node.value.index + i, arena, symbols));
+
+            return sec;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+void
+config::compile(const string& file_path) const {
+    snapshot_writer(*this).write(file_path);
+}
+
+config*
+config::load_compiled(const string& file_path) {
+#if defined(CONFIG_SINGLETON)
+    return initialize(file_path, LOAD_COMPILED | LOAD_ARENA);
+#else
+    return new config(file_path, LOAD_COMPILED | LOAD_ARENA);
+#endif
+}
@@ -0,0 +1,116 @@
+/**
+ * @file config-snapshot.hh
+ *
+ * Layout of the binary snapshots written by config::compile.
+ *
+ *      snapshot_header
+ *      snapshot_node[node_count]       @ node_offset
+ *      char[data_size]                 @ data_offset
+ *      char[string_size]               @ string_offset
+ *
+ * Every reference within the file is an offset (into the data region or the string pool)
+ * or an index (into the node table) so the file may be mapped at any address.  Node 0 is
+ * the root section.  Nodes are laid out breadth first; the children of a section or vector
+ * occupy the contiguous range [value.index, value.index + size) and every child range
+ * begins exactly where the previous one ended, which is what makes a snapshot a tree.
+ *
+ * A packed vector (@see kwarg_vector::span) is a single node with no children.  Its size
+ * elements are stored as they are in memory at value.offset of the data region; the
+ * region and every vector in it are 8 byte aligned.
+ */
+#ifndef __CONFIG_SNAPSHOT_HH_
+#define __CONFIG_SNAPSHOT_HH_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "config.hh"
+#include "config-source.hh"
+
+
+enum { SNAPSHOT_VERSION    = 2
+     , SNAPSHOT_BYTE_ORDER = 0x01020304 };
+
+/// node types beyond kwarg::TYPE; a packed vector of int64_t, double or bool
+enum { SNAPSHOT_PACKED_INTEGRAL = 0x100
+     , SNAPSHOT_PACKED_FLOATING
+     , SNAPSHOT_PACKED_BOOL };
+
+struct snapshot_header {
+    char     magic[8];          /*< "CFGSNAP" >*/
+    uint32_t version;
+    uint32_t byte_order;        /*< SNAPSHOT_BYTE_ORDER as written by the compiler >*/
+    uint64_t file_size;
+    uint64_t node_count;
+    uint64_t node_offset;
+    uint64_t data_offset;
+    uint64_t data_size;
+    uint64_t string_offset;
+    uint64_t string_size;
+    uint64_t reserved;
+};
+
+struct snapshot_node {
+    uint32_t type;              /*< kwarg::TYPE or SNAPSHOT_PACKED_* >*/
+    uint32_t name_size;
+    uint64_t name_offset;
+
+    union {
+        int64_t  integral;
+        double   floating;
+        uint64_t boolean;
+        uint64_t offset;        /*< STRING: offset of the value in the string pool,
+                                    SNAPSHOT_PACKED_*: of the elements in the data >*/
+        uint64_t index;         /*< SECTION, VECTOR: index of the first child >*/
+    } value;
+
+    uint64_t size;              /*< STRING: length, SECTION, VECTOR: child count,
+                                    SNAPSHOT_PACKED_*: element count >*/
+};
+
+static_assert(sizeof(snapshot_header) == 80, "snapshot_header layout");
+static_assert(sizeof(snapshot_node)   == 32, "snapshot_node layout");
+
+extern const char SNAPSHOT_MAGIC[8];
+
+/**
+ * @class snapshot_reader
+ *
+ * Maps a snapshot and validates all of it up front, so that rebuilding the tree can not
+ * fail half way through and leave a partially owned hierarchy behind.
+ *
+ * @throw config_io_error
+ * @throw config_parse_exception
+ */
+class snapshot_reader {
+public:
+    explicit snapshot_reader(const std::string& file_path);
+
+    /// rebuilds the children of the root node into root, naming them from symbols
+    void load(config_section& root, config_arena* arena, symbol_table& symbols) const;
+
+    /// content_hash of the whole file
+    uint64_t hash() const
+    { return content_hash(_M_source->data(), _M_source->size()); }
+
+    /// bytes in the file
+    uint64_t size() const
+    { return _M_source->size(); }
+
+    snapshot_reader(const snapshot_reader&) = delete;
+    snapshot_reader& operator=(const snapshot_reader&) = delete;
+
+private:
+    void _M_validate();
+    std::string _M_string(uint64_t offset, uint64_t size) const;
+    kwarg* _M_build(uint64_t index, config_arena* arena, symbol_table& symbols) const;
+
+    std::string                     _M_path;
+    std::unique_ptr<source_buffer>  _M_source;
+    const snapshot_node*            _M_nodes;
+    const char*                     _M_data;
+    const char*                     _M_strings;
+};
+
+#endif //__CONFIG_SNAPSHOT_HH_
@@ -0,0 +1,211 @@
+/**
+ * @file config-source.hh
+ *
+ * File access shared by the text parser, the include loader and the snapshot loader.
+ */
+#ifndef __CONFIG_SOURCE_HH_
+#define __CONFIG_SOURCE_HH_
+
+#include <fcntl.h>
+#include <libgen.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cassert>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "config.hh"
+
+
+/**
+ * Fast non-cryptographic hash of the contents of a file; used to tell a real change from a
+ * save which rewrote the same bytes.  @see config::sources
+ */
+inline uint64_t
+content_hash(const char* data, size_t size) {
+    uint64_t hash = 0x9E3779B97F4A7C15ull ^ size;
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash  = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail, data + i, size - i);
+    hash  = (hash ^ tail) * 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+/// path made absolute against the working directory without resolving it
+inline std::string
+absolute_path(const std::string& path) {
+    if (! path.empty() && '/' == path[0])
+        return path;
+
+    char buf[PATH_MAX + 1];
+
+    if (0x0 == ::getcwd(buf, sizeof(buf)))
+        return path;
+
+    return std::string(buf) + "/" + path;
+}
+
+/// the resolved location of a config file
+struct path_info {
+    std::string abspath;
+    std::string dirpath;
+    std::string file_name;
+};
+
+/**
+ * @throw config_io_error if path does not exist
+ */
+inline path_info
+get_path_info(const std::string& path) {
+    path_info info;
+    std::string new_path;
+    new_path.reserve(path.size());
+
+    for (auto it = path.begin(); it != path.end(); ++it) {
+        switch (*it) {
+            case '/':
+                if (*(it + 1) == '/')
+                    continue;
+                break;
+
+            default:
+                break;
+        }
+
+        new_path.append(1, *it);
+    }
+
+    assert(std::string::npos == new_path.find("//"));
+
+    char buf[PATH_MAX + 1];
+    char* ptr;
+    ptr = realpath(path.c_str(), buf);
+
+    if (0x0 == ptr)
+        throw config_io_error(path);
+    else
+        info.abspath = std::string(ptr);
+
+    memcpy(buf, info.abspath.c_str(), info.abspath.size());
+    ptr = dirname(buf);
+
+    if (0x0 == ptr)
+        throw config_io_error(path);
+    else
+        info.dirpath = std::string(ptr);
+
+    memcpy(buf, info.abspath.c_str(), info.abspath.size());
+    ptr = basename(buf);
+
+    if (0x0 == ptr)
+        throw config_io_error(path);
+    else
+        info.file_name = std::string(ptr);
+
+    return info;
+}
+
+/**
+ * @class source_buffer
+ *
+ * Owns the bytes of a single config file for the duration of its parse.  The file is
+ * either mapped read-only (config::LOAD_MMAP) or read with a single bulk read, in both
+ * cases it is handed to the lexer as a bounded _Iter so no NUL terminator is needed.
+ *
+ * @throw config_io_error
+ */
+class source_buffer {
+public:
+    source_buffer(const std::string& path, bool use_mmap)
+        : _M_map(MAP_FAILED), _M_begin(0x0), _M_size(0)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0)
+            throw config_io_error(path);
+
+        struct stat st;
+
+        if (0 != ::fstat(fd, &st)) {
+            ::close(fd);
+            throw config_io_error(path);
+        }
+
+        _M_size = static_cast<size_t>(st.st_size);
+
+        if (use_mmap && _M_size > 0) {
+            _M_map = ::mmap(0x0, _M_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+
+            if (MAP_FAILED != _M_map) {
+                ::madvise(_M_map, _M_size, MADV_SEQUENTIAL);
+                _M_begin = static_cast<const char*>(_M_map);
+            }
+        }
+
+        if (MAP_FAILED == _M_map && ! _M_read(fd)) {
+            ::close(fd);
+            throw config_io_error(path);
+        }
+
+        ::close(fd);
+    }
+
+    ~source_buffer() {
+        if (MAP_FAILED != _M_map)
+            ::munmap(_M_map, _M_size);
+    }
+
+    _Iter
+    iter() const {
+        return _Iter(_M_begin, _M_begin + _M_size);
+    }
+
+    const char* data() const { return _M_begin; }
+    size_t      size() const { return _M_size;  }
+
+    source_buffer(const source_buffer&) = delete;
+    source_buffer& operator=(const source_buffer&) = delete;
+
+private:
+    bool
+    _M_read(int fd) {
+        _M_data.resize(_M_size);
+        size_t offset = 0;
+
+        while (offset < _M_size) {
+            const ssize_t rc = ::read(fd, &_M_data[offset], _M_size - offset);
+
+            if (rc < 0)
+                return false;
+            else if (0 == rc)
+                break;
+
+            offset += static_cast<size_t>(rc);
+        }
+
+        _M_data.resize(offset);
+        _M_size  = offset;
+        _M_begin = _M_data.data();
+        return true;
+    }
+
+    std::string _M_data;
+    void*       _M_map;
+    const char* _M_begin;
+    size_t      _M_size;
+};
+
+#endif //__CONFIG_SOURCE_HH_
@@ -0,0 +1,92 @@
+#include "config-trace.hh"
+
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <cstdio>
+
+
+using std::string;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+namespace {
+
+/// appends str as the body of a JSON string
+void
+append_escaped(string& out, const string& str) {
+    for (auto it = str.begin(); it != str.end(); ++it) {
+        const unsigned char c = *it;
+
+        if ('"' == c || '\\' == c) {
+            out += '\\';
+            out += c;
+        } else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+}
+
+} // ns
+
+//////////////////////////////////////////////////////////////////////////////////////////
+std::atomic<config_trace*> config_trace::_S_installed(0x0);
+
+config_trace::config_trace(const string& file_path)
+    : _M_out(file_path, std::ios::trunc), _M_pid(::getpid()), _M_empty(true)
+{
+    _M_out << "[";
+
+    if (! _M_out)
+        throw config_io_error(file_path);
+}
+
+config_trace::~config_trace() {
+    /* loads which are still running must not write into a closed trace */
+    config_trace* self = this;
+    _S_installed.compare_exchange_strong(self, 0x0);
+
+    _M_out << "\n]\n";
+}
+
+uint64_t
+config_trace::now() {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void
+config_trace::complete(const char* category, const char* name, const string& detail
+                     , uint64_t begin_ns, uint64_t end_ns) {
+    const long tid = ::syscall(SYS_gettid);
+    const uint64_t dur_ns = end_ns - begin_ns;
+
+    /* timestamps are in us; the fraction keeps ns resolution */
+    char times[96];
+    snprintf(times, sizeof(times), "\"ts\":%llu.%03u,\"dur\":%llu.%03u"
+           , (unsigned long long) (begin_ns / 1000), unsigned(begin_ns % 1000)
+           , (unsigned long long) (dur_ns / 1000), unsigned(dur_ns % 1000));
+
+    string event = "{\"name\":\"";
+    append_escaped(event, name);
+    event += "\",\"cat\":\"";
+    append_escaped(event, category);
+    event += "\",\"ph\":\"X\",";
+    event += times;
+    event += ",\"pid\":" + std::to_string(_M_pid);
+    event += ",\"tid\":" + std::to_string(tid);
+    event += ",\"args\":{\"detail\":\"";
+    append_escaped(event, detail);
+    event += "\"}}";
+
+    std::lock_guard<std::mutex> lock(_M_lock);
+    _M_out << (_M_empty ? "\n" : ",\n") << event;
+    _M_out.flush();
+    _M_empty = false;
+}
@@ -0,0 +1,329 @@
+#include "config-watch.hh"
+#include "config-source.hh"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+
+using std::string;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+namespace {
+
+/// everything which can replace, rewrite, create or remove a file in a directory, or
+/// remove or rename the directory itself
+const uint32_t WATCH_MASK = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB
+                          | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                          | IN_DELETE_SELF | IN_MOVE_SELF;
+
+string
+parent_directory(const string& path) {
+    const size_t slash = path.rfind('/');
+
+    if (string::npos == slash)
+        return ".";
+    else if (0 == slash)
+        return "/";
+    else
+        return path.substr(0, slash);
+}
+
+} // ns
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+config_watcher::config_watcher(config_handle& handle, unsigned debounce_ms)
+    : _M_handle(handle)
+    , _M_debounce_ms(debounce_ms)
+    , _M_inotify(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+    , _M_reloads(0)
+    , _M_failures(0)
+{
+    if (_M_inotify < 0)
+        throw config_io_error("inotify_init1");
+
+    if (0 != ::pipe2(_M_wake, O_NONBLOCK | O_CLOEXEC)) {
+        ::close(_M_inotify);
+        throw config_io_error("pipe2");
+    }
+
+    /* a file which changed while the snapshot was loading raised no event */
+    if (_M_watch())
+        _M_dirty.insert("");
+
+    _M_thread = std::thread(&config_watcher::_M_run, this);
+}
+
+config_watcher::~config_watcher() {
+    const char stop = 0;
+
+    while (::write(_M_wake[1], &stop, 1) < 0 && EINTR == errno)
+        ;
+
+    _M_thread.join();
+
+    ::close(_M_wake[0]);
+    ::close(_M_wake[1]);
+    ::close(_M_inotify);
+}
+
+string
+config_watcher::last_error() const {
+    std::lock_guard<std::mutex> lock(_M_error_lock);
+    return _M_last_error;
+}
+
+config_watcher::file_state
+config_watcher::_S_state(const string& path) {
+    file_state state;
+
+    try {
+        source_buffer source(path, false);
+        state.present = true;
+        state.hash    = content_hash(source.data(), source.size());
+    } catch (const config_io_error&) {
+        state.present = false;
+        state.hash    = 0;
+    }
+
+    return state;
+}
+
+void
+config_watcher::_M_run() {
+    typedef std::chrono::steady_clock clock;
+
+    /* events are read into a buffer aligned for inotify_event */
+    alignas(struct inotify_event) char buf[4096];
+    clock::time_point deadline = clock::now();
+
+    for (;;) {
+        int timeout = -1;
+
+        if (! _M_dirty.empty()) {
+            const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                deadline - clock::now()).count();
+            timeout = wait > 0 ? static_cast<int>(wait) : 0;
+        }
+
+        struct pollfd fds[2] = { { _M_inotify, POLLIN, 0 }, { _M_wake[0], POLLIN, 0 } };
+
+        if (::poll(fds, 2, timeout) < 0) {
+            if (EINTR != errno) {
+                /* reported, and retried once the debounce interval has passed */
+                _M_fail(string("poll: ") + std::strerror(errno));
+                std::this_thread::sleep_for(std::chrono::milliseconds(
+                            _M_debounce_ms ? _M_debounce_ms : 1));
+            }
+
+            continue;
+        }
+
+        if (fds[1].revents)
+            return;
+
+        if (fds[0].revents & POLLIN) {
+            ssize_t size;
+
+            while ((size = ::read(_M_inotify, buf, sizeof(buf))) > 0) {
+                for (char* ptr = buf; ptr < buf + size; ) {
+                    const struct inotify_event* ev
+                        = reinterpret_cast<const struct inotify_event*>(ptr);
+                    ptr += sizeof(struct inotify_event) + ev->len;
+
+                    auto dir = _M_dirs.find(ev->wd);
+
+                    if (ev->mask & IN_Q_OVERFLOW) {
+                        /* events were lost; every file is checked */
+                        _M_dirty.insert("");
+                    } else if (dir != _M_dirs.end()
+                            && (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))) {
+                        /* a watched directory was removed, or renamed (and the watch
+                         * would follow it); every directory is watched again by path,
+                         * and every file checked */
+                        _M_arm();
+                        _M_dirty.insert("");
+                    } else if (dir != _M_dirs.end() && ev->len > 0) {
+                        const string path = ("/" == dir->second ? "" : dir->second)
+                                          + "/" + ev->name;
+
+                        if (_M_files.count(path)) {
+                            _M_dirty.insert(path);
+                        } else if ((ev->mask & (IN_CREATE | IN_MOVED_TO))
+                                && _M_missing.count(path)) {
+                            /* a directory on the way to a missing one appeared; watch
+                             * nearer, and check every file in case one arrived first */
+                            _M_arm();
+                            _M_dirty.insert("");
+                        } else if ((ev->mask & (IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO))
+                                && _M_encloses(path)) {
+                            /* a directory above a watched one was removed or replaced */
+                            _M_arm();
+                            _M_dirty.insert("");
+                        } else {
+                            continue;
+                        }
+                    } else {
+                        continue;
+                    }
+
+                    deadline = clock::now() + std::chrono::milliseconds(_M_debounce_ms);
+                }
+            }
+        }
+
+        if (! _M_dirty.empty() && clock::now() >= deadline) {
+            if (_M_dirty.count("")) {
+                _M_dirty.clear();
+
+                for (auto it = _M_files.begin(); it != _M_files.end(); ++it)
+                    _M_dirty.insert(it->first);
+            }
+
+            std::unordered_set<string> dirty;
+            dirty.swap(_M_dirty);
+
+            if (_M_changed(dirty))
+                _M_reload(dirty);
+        }
+    }
+}
+
+void
+config_watcher::_M_reload(const std::unordered_set<string>& dirty) {
+    try {
+        _M_handle.reload();
+        _M_reloads.fetch_add(1, std::memory_order_release);
+    } catch (const std::exception& e) {
+        _M_fail(e.what());
+
+        /* the broken contents are not retried until they change again */
+        for (auto it = dirty.begin(); it != dirty.end(); ++it)
+            if (_M_files.count(*it))
+                _M_files[*it] = _S_state(*it);
+
+        /* the failure may be a directory which was removed or replaced; the files of the
+         * current snapshot are watched again wherever their directories now are */
+        _M_arm();
+
+        if (_M_stale())
+            _M_dirty.insert("");
+
+        return;
+    }
+
+    if (_M_watch())
+        _M_dirty.insert("");
+}
+
+void
+config_watcher::_M_fail(const string& what) {
+    {
+        std::lock_guard<std::mutex> lock(_M_error_lock);
+        _M_last_error = what;
+    }
+
+    _M_failures.fetch_add(1, std::memory_order_release);
+}
+
+void
+config_watcher::_M_arm() {
+    /* the new watches are added before the old are removed, so that a directory watched
+     * throughout keeps its watch (and its events) rather than losing any made between */
+    std::unordered_map<int, string> previous;
+    previous.swap(_M_dirs);
+    _M_missing.clear();
+
+    for (auto it = _M_files.begin(); it != _M_files.end(); ++it) {
+        string dir = parent_directory(it->first);
+        int wd;
+
+        /* a directory which does not exist (yet) is waited for from the nearest one
+         * which does */
+        while ((wd = ::inotify_add_watch(_M_inotify, dir.c_str(), WATCH_MASK)) < 0) {
+            const string parent = parent_directory(dir);
+
+            if (ENOENT != errno && ENOTDIR != errno)
+                break;
+
+            _M_missing.insert(dir);
+
+            if (parent == dir)
+                break;
+
+            dir = parent;
+        }
+
+        if (wd >= 0)
+            _M_dirs[wd] = dir;
+    }
+
+    for (auto it = previous.begin(); it != previous.end(); ++it)
+        if (0 == _M_dirs.count(it->first))
+            ::inotify_rm_watch(_M_inotify, it->first);
+}
+
+bool
+config_watcher::_M_watch() {
+    _M_files.clear();
+
+    const config_handle::snapshot current = _M_handle.acquire();
+    const std::vector<config_source>& sources = current->sources();
+
+    for (auto it = sources.begin(); it != sources.end(); ++it) {
+        file_state& state = _M_files[it->path];
+        state.present = it->present;
+        state.hash    = it->hash;
+    }
+
+    _M_arm();
+
+    /* anything which changed between being parsed and being watched */
+    return _M_stale();
+}
+
+bool
+config_watcher::_M_encloses(const string& path) const {
+    for (auto it = _M_dirs.begin(); it != _M_dirs.end(); ++it)
+        if (0 == it->second.compare(0, path.size(), path)
+         && '/' == it->second[path.size()])
+            return true;
+
+    return false;
+}
+
+bool
+config_watcher::_M_stale() const {
+    for (auto it = _M_files.begin(); it != _M_files.end(); ++it) {
+        const file_state now = _S_state(it->first);
+
+        if (now.present != it->second.present || now.hash != it->second.hash)
+            return true;
+    }
+
+    return false;
+}
+
+bool
+config_watcher::_M_changed(const std::unordered_set<string>& paths) const {
+    for (auto it = paths.begin(); it != paths.end(); ++it) {
+        auto file = _M_files.find(*it);
+
+        if (file == _M_files.end())
+            continue;
+
+        const file_state now = _S_state(*it);
+
+        if (now.present != file->second.present || now.hash != file->second.hash)
+            return true;
+    }
+
+    return false;
+}
@@ -1,24 +1,43 @@
 #include "config.hh"
-
+#include "config-cache.hh"
+#include "config-number.hh"
+#include "config-profile.hh"
+#include "config-sax.hh"
+#include "config-scan.hh"
+#include "config-snapshot.hh"
+#include "config-source.hh"
+#include "config-trace.hh"
+
+#include <fcntl.h>
 #include <libgen.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <cassert>
 #include <climits>
 #include <cstdlib>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <iomanip>
 #include <iostream>
-#include <locale>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
+#if defined(CONFIG_USDT)
+#include <sys/sdt.h>
+#endif
+
 
 using std::function;
 using std::getline;
-using std::ifstream;
-using std::istreambuf_iterator;
-using std::locale;
 using std::mismatch;
 using std::string;
 using std::stringstream;
@@ -32,8 +51,6 @@ using std::unique_ptr;
 //////////////////////////////////////////////////////////////////////////////////////////
 namespace {
 
-locale _S_locale;
-
 #if defined(CONFIG_SINGLETON)
 void
 config_cleanup_atexit() {
@@ -42,6 +59,248 @@ config_cleanup_atexit() {
 }
 #endif // CONFIG_SINGLETON
 
+/**
+ * Records a file which was read (or looked for) on behalf of config::sources, of the
+ * include being recorded for the cache and of the cache's view of the current load.
+ */
+void
+note_source(parse_context& ctx, const string& abspath, bool present, uint64_t hash) {
+    config_source source;
+    source.path    = abspath;
+    source.present = present;
+    source.hash    = present ? hash : 0;
+
+    if (ctx.cache)
+        ctx.cache->note(source);
+
+    if (ctx.record)
+        ctx.record->sources.push_back(source);
+
+    if (ctx.sources)
+        ctx.sources->push_back(source);
+}
+
+/// the stats of the file being parsed, or 0x0 if none are being collected
+parse_stats::file*
+file_stats(parse_context& ctx) {
+    if (0x0 == ctx.stats || parse_context::NO_FILE == ctx.stats_file)
+        return 0x0;
+
+    return &ctx.stats->files[ctx.stats_file];
+}
+
+/// counts a node of type created by the parse, or an element packed in place of one
+void
+note_kwarg(parse_context& ctx, kwarg::TYPE type) {
+    parse_stats::file* stats = file_stats(ctx);
+
+    if (0x0 == stats)
+        return;
+
+    ++stats->kwargs;
+
+    if (kwarg::SECTION == type)
+        ++stats->sections;
+    else if (kwarg::VECTOR == type)
+        ++stats->vectors;
+}
+
+void
+note_kwarg(parse_context& ctx, const kwarg* ptr) {
+    note_kwarg(ctx, ptr->type());
+}
+
+/// counts a match against one of the keyword tries
+void
+note_keyword(parse_context& ctx) {
+    parse_stats::file* stats = file_stats(ctx);
+
+    if (stats)
+        ++stats->trie_lookups;
+}
+
+/**
+ * @class stats_scope
+ *
+ * Charges everything counted while it lives to a new entry of ctx.stats for abspath;
+ * scopes nest with the includes of a file.
+ */
+class stats_scope {
+public:
+    stats_scope(parse_context& ctx, const string& abspath, uint64_t bytes)
+        : _M_ctx(ctx), _M_outer(ctx.stats_file)
+    {
+        if (0x0 == ctx.stats)
+            return;
+
+        parse_stats::file file;
+        file.path  = abspath;
+        file.bytes = bytes;
+
+        if (parse_context::NO_FILE != _M_outer)
+            file.include_depth = ctx.stats->files[_M_outer].include_depth + 1;
+
+        ctx.stats->files.push_back(file);
+        ctx.stats_file = ctx.stats->files.size() - 1;
+        _M_begin = std::chrono::steady_clock::now();
+    }
+
+    ~stats_scope() {
+        if (0x0 == _M_ctx.stats)
+            return;
+
+        const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - _M_begin).count();
+
+        std::vector<parse_stats::file>& files = _M_ctx.stats->files;
+        files[_M_ctx.stats_file].wall_ns  = ns;
+        files[_M_ctx.stats_file].self_ns += ns;
+
+        /* the outer file adds its own wall time when it ends; the unsigned sum wraps
+         * back into range */
+        if (parse_context::NO_FILE != _M_outer)
+            files[_M_outer].self_ns -= ns;
+
+        _M_ctx.stats_file = _M_outer;
+    }
+
+    stats_scope(const stats_scope&) = delete;
+    stats_scope& operator=(const stats_scope&) = delete;
+
+private:
+    parse_context&                          _M_ctx;
+    const size_t                            _M_outer;
+    std::chrono::steady_clock::time_point   _M_begin;
+};
+
+/// appends the files of a detached parse as includes of the file being parsed
+void
+merge_stats(parse_context& ctx, const parse_stats& detached) {
+    if (0x0 == ctx.stats)
+        return;
+
+    const parse_stats::file* outer = file_stats(ctx);
+    const unsigned depth = outer ? outer->include_depth + 1 : 0;
+
+    /* push_back may move the outer file */
+    for (auto it = detached.files.begin(); it != detached.files.end(); ++it) {
+        ctx.stats->files.push_back(*it);
+        ctx.stats->files.back().include_depth += depth;
+    }
+}
+
+/// fills .total once a load which took wall_ns is complete
+void
+sum_stats(parse_stats& stats, uint64_t wall_ns) {
+    parse_stats::file& total = stats.total;
+
+    for (auto it = stats.files.begin(); it != stats.files.end(); ++it) {
+        total.bytes            += it->bytes;
+        total.self_ns          += it->self_ns;
+        total.kwargs           += it->kwargs;
+        total.sections         += it->sections;
+        total.vectors          += it->vectors;
+        total.macro_expansions += it->macro_expansions;
+        total.trie_lookups     += it->trie_lookups;
+        total.include_depth     = std::max(total.include_depth, it->include_depth);
+    }
+
+    total.wall_ns = wall_ns;
+}
+
+/// the detail of a span which concerns no particular file or key
+const string NO_DETAIL;
+
+/**
+ * @class trace_scope
+ *
+ * Writes a span of the load to trace, if any, when it ends; with CONFIG_USDT it also
+ * fires the phase probes.  detail must outlive the scope.  @see config_trace
+ */
+class trace_scope {
+public:
+    trace_scope(config_trace* trace, const char* category, const char* name
+              , kwarg_key detail)
+        : _M_trace(trace), _M_category(category), _M_name(name), _M_detail(detail)
+        , _M_begin(0)
+    {
+#if defined(CONFIG_USDT)
+        DTRACE_PROBE3(appconf, phase__begin, category, name, detail.data());
+#endif
+        if (_M_trace)
+            _M_begin = config_trace::now();
+    }
+
+    ~trace_scope() {
+#if defined(CONFIG_USDT)
+        DTRACE_PROBE2(appconf, phase__end, _M_category, _M_name);
+#endif
+        if (_M_trace)
+            _M_trace->complete(_M_category, _M_name, _M_detail.str(), _M_begin
+                             , config_trace::now());
+    }
+
+    trace_scope(const trace_scope&) = delete;
+    trace_scope& operator=(const trace_scope&) = delete;
+
+private:
+    config_trace* const _M_trace;
+    const char* const   _M_category;
+    const char* const   _M_name;
+    const kwarg_key     _M_detail;
+    uint64_t            _M_begin;
+};
+
+/// records a change to the registers made by @define or @import
+void
+note_define(parse_context& ctx, const string& name, const string& value) {
+    ++ctx.regs_version;
+
+    if (0x0 == ctx.record)
+        return;
+
+    macro_dep dep;
+    dep.kind     = macro_dep::DEFINE;
+    dep.token    = name;
+    dep.consumed = 0;
+    dep.value    = value;
+    ctx.record->deps.push_back(std::move(dep));
+}
+
+/// appends a finished record of a nested include to the one being recorded, if any
+void
+merge_record(parse_context& ctx, const include_record& record) {
+    if (0x0 == ctx.record)
+        return;
+
+    ctx.record->deps.insert(ctx.record->deps.end()
+                          , record.deps.begin(), record.deps.end());
+    ctx.record->sources.insert(ctx.record->sources.end()
+                             , record.sources.begin(), record.sources.end());
+}
+
+/**
+ * Has the effects of parsing an include again when its cached variant is reused; its
+ * files are noted and its definitions applied to the registers.
+ */
+void
+replay_record(parse_context& ctx, const include_record& record) {
+    for (auto it = record.sources.begin(); it != record.sources.end(); ++it)
+        note_source(ctx, it->path, it->present, it->hash);
+
+    for (auto it = record.deps.begin(); it != record.deps.end(); ++it) {
+        if (macro_dep::DEFINE != it->kind)
+            continue;
+
+        ctx.regs->defval(it->token) = it->value;
+        ++ctx.regs_version;
+    }
+
+    if (ctx.record)
+        ctx.record->deps.insert(ctx.record->deps.end()
+                              , record.deps.begin(), record.deps.end());
+}
+
 bool
 eos(_Iter& iter, bool do_throw) {
     if (*iter == '\0') {
@@ -54,186 +313,243 @@ eos(_Iter& iter, bool do_throw) {
     }
 }
 
+/**
+ * A macro lookup which a parse being recorded for the include cache notes as something it
+ * depended on; iter points just past the '$'.
+ */
+const string&
+lookup_recorded(_Iter& iter, parse_context& ctx) {
+    if (0x0 == ctx.record)
+        return ctx.regs->lookup(iter);
+
+    const char* token = std::min(iter.base(), iter.end());
+    const char* word  = ('{' == *iter) ? token + 1 : token;
+
+    macro_dep dep;
+    dep.kind = macro_dep::LOOKUP;
+    dep.token.assign(token, scan::skip_word(word, iter.end()));
+
+    try {
+        const string& value = ctx.regs->lookup(iter);
+        dep.consumed = iter.base() - token;
+        dep.value    = value;
+        ctx.record->deps.push_back(std::move(dep));
+        return value;
+    } catch (const trie_lookup_error&) {
+        dep.consumed = string::npos;
+        ctx.record->deps.push_back(std::move(dep));
+        throw;
+    }
+}
+
+/// every macro lookup goes through here; iter points just past the '$'
+const string&
+lookup_macro(_Iter& iter, parse_context& ctx) {
+    parse_stats::file* stats = file_stats(ctx);
+
+    if (0x0 == stats)
+        return lookup_recorded(iter, ctx);
+
+    /* a lookup which does not resolve throws before it is counted as an expansion */
+    ++stats->trie_lookups;
+    const string& value = lookup_recorded(iter, ctx);
+    ++stats->macro_expansions;
+    return value;
+}
+
+template <typename _Sink>
 void
-append_regs(string& data, _Iter& iter, parse_trie<string>* regs) {
+append_regs(_Sink& data, _Iter& iter, parse_context& ctx) {
     assert(*iter == '$');
     const bool is_bracketed = (*(iter + 1) == '{');
-    data.append(regs->lookup(++iter));
+    data.append(lookup_macro(++iter, ctx));
 
     if (is_bracketed)
         ++iter;
 }
 
-struct path_info {
-    string  abspath;
-    string  dirpath;
-    string  file_name;
-};
+bool
+bypass_whitespace(_Iter& iter, bool do_throw = true) {
+    const char* ptr = iter.base();
+    const char* end = iter.end();
 
-path_info
-get_path_info(const string& path) {
-    path_info info;
-    string new_path;
-    new_path.reserve(path.size());
+    for (;;) {
+        ptr = scan::skip_space(ptr, end);
 
-    for (auto it = path.begin(); it != path.end(); ++it) {
-        switch (*it) {
-            case '/':
-                if (*(it + 1) == '/')
-                    continue;
-                break;
+        if (end - ptr < 2 || '/' != ptr[0])
+            break;
 
-            default:
-                break;
+        if ('*' == ptr[1]) {
+            /* the search for the close starts on the opening '*', so a lone
+             * slash after it already ends the comment, as it always has */
+            const char* close = scan::find_comment_end(ptr + 1, end);
+            ptr = close ? close + 2 : end;
+        } else if ('/' == ptr[1]) {
+            ptr = scan::find_line_end(ptr, end);
+        } else {
+            break;
         }
-
-        new_path.append(1, *it);
     }
 
-    assert(string::npos == new_path.find("//"));
+    iter.seek(ptr);
+    return ! eos(iter, do_throw);
+}
+
+string
+parse_word(_Iter& iter) {
+    const char* word = iter.base();
+    iter.seek(scan::skip_word(word, iter.end()));
+    eos(iter, true);
 
-    char buf[PATH_MAX + 1];
-    char* ptr;
-    ptr = realpath(path.c_str(), buf);
+    if (iter.base() == word)
+        throw config_parse_exception("empty word", iter);
 
-    if (0x0 == ptr)
-        throw config_io_error(path);
-    else
-        info.abspath = string(ptr);
+    return string(word, iter.base());
+}
 
-    memcpy(buf, info.abspath.c_str(), info.abspath.size());
-    ptr = dirname(buf);
+/**
+ * Text of a number which had a macro spliced into it.  Numbers are short so the pieces
+ * are assembled on the stack rather than in a string.
+ */
+class number_buffer {
+public:
+    number_buffer()
+        : _M_size(0)
+    {}
+
+    void
+    append(const char* first, const char* last, const _Iter& iter) {
+        if (static_cast<size_t>(last - first) > sizeof(_M_data) - _M_size)
+            throw config_parse_exception("number too long", iter);
+
+        memcpy(_M_data + _M_size, first, last - first);
+        _M_size += last - first;
+    }
 
-    if (0x0 == ptr)
-        throw config_io_error(path);
-    else
-        info.dirpath = string(ptr);
+    const char* begin() const { return _M_data; }
+    const char* end()   const { return _M_data + _M_size; }
 
-    memcpy(buf, info.abspath.c_str(), info.abspath.size());
-    ptr = basename(buf);
+private:
+    char    _M_data[128];
+    size_t  _M_size;
+};
 
-    if (0x0 == ptr)
-        throw config_io_error(path);
-    else
-        info.file_name = string(ptr);
+const char*
+skip_number(const char* ptr, const char* end) {
+    while (ptr != end && numeric::is_number_char(*ptr))
+        ++ptr;
 
-    return info;
+    return ptr;
 }
 
-bool
-bypass_whitespace(_Iter& iter, bool do_throw = true) {
-    /* macro is used to encode a 2 byte sequence and an "in_comment" status for a unique
-     * value which can be used in the jump table.
-     */
-    #define str_sequence(_a_, _b_, _c_) ((_a_ << 16) | (_b_ << 8) | (_c_))
+numeric::value
+lex_number(_Iter& iter, parse_context& ctx) {
+    assert('=' != *iter);
+    bypass_whitespace(iter);
 
-    bool in_comment = false;
+    /* the number is lexed in place unless a macro is spliced into it */
+    const char* first = iter.base();
+    iter.seek(skip_number(first, iter.end()));
+    const char* last  = iter.base();
 
-    while (! eos(iter, do_throw)) {
-        switch (str_sequence(*iter, *(iter + 1), in_comment)) {
-            case str_sequence('/', '*', false):
-                in_comment = true;
-                break;
+    number_buffer data;
 
-            case str_sequence('*', '/', true):
-                ++iter; /*< due to look ahead >*/
-                in_comment = false;
-                break;
+    if ('$' == *iter) {
+        data.append(first, last, iter);
 
-            case str_sequence('/', '/', false):
-                while (! eos(iter, do_throw) && *iter != '\n')
-                    ++iter;
-                break;
+        while ('$' == *iter) {
+            const bool is_bracketed = (*(iter + 1) == '{');
+            const string& value = lookup_macro(++iter, ctx);
+            data.append(value.data(), value.data() + value.size(), iter);
 
-            default:
-                if (! in_comment && ! isspace(*iter, _S_locale))
-                    goto exit_loop;
+            if (is_bracketed)
+                ++iter;
 
-                break;
+            const char* run = iter.base();
+            iter.seek(skip_number(run, iter.end()));
+            data.append(run, iter.base(), iter);
         }
 
-        ++iter;
+        first = data.begin();
+        last  = data.end();
     }
 
-exit_loop:
-    return ! eos(iter, false);
-#undef str_sequence
-}
+    eos(iter, true);
+    numeric::value number;
 
-string
-parse_word(_Iter& iter) {
-    string word;
+    switch (numeric::lex(first, last, number)) {
+        case numeric::VALID:
+            break;
 
-    while (! eos(iter, true) && acceptable_char(*iter))
-        word.append(1, *(iter++));
+        case numeric::EMPTY:
+            throw config_parse_exception("empty number", iter);
 
-    if (0 == word.size())
-        throw config_parse_exception("empty word", iter);
+        case numeric::MALFORMED:
+            throw config_parse_exception("malformed number", iter);
+
+        case numeric::OUT_OF_RANGE:
+            throw config_parse_exception("number out of range", iter);
+    }
 
-    return word;
+    return number;
 }
 
 kwarg*
-parse_number(const string& name, _Iter& iter, parse_trie<string>* regs) {
-    assert('=' != *iter);
-    string data;
-    bypass_whitespace(iter);
-
-    while (! eos(iter, true)) {
-        switch (*iter) {
-            case '$':
-                append_regs(data, iter, regs);
-                continue;
-                break;
-
-            case '-':
-            case '0':
-            case '1':
-            case '2':
-            case '3':
-            case '4':
-            case '5':
-            case '6':
-            case '7':
-            case '8':
-            case '9':
-            case '.':
-                data.append(1, *iter);
-                break;
-
-            default:
-                goto exit_loop;
-        }
-
-        ++iter;
-        continue;
+parse_number(const config_symbol* name, _Iter& iter, parse_context& ctx) {
+    const numeric::value number = lex_number(iter, ctx);
 
-exit_loop:
-        break;
-    }
+    if (number.integral)
+        return new (ctx.arena) kwarg_const(number.i, name, ctx.arena);
+    else
+        return new (ctx.arena) kwarg_const(number.d, name, ctx.arena);
+}
 
-    if (0 == data.size())
-        throw config_parse_exception("empty number", iter);
+/**
+ * An element of a vector as it is parsed.  A number or boolean is held as a value until
+ * the vector knows whether it packs; any other element (.type UNDEFINED) is its node.
+ */
+struct vector_element {
+    kwarg::TYPE type;
+
+    union {
+        int64_t integral;
+        double  floating;
+        bool    boolean;
+        kwarg*  node;
+    } value;
+};
 
-    if (data.find('.') == string::npos) {
-        /* INTEGRAL */
-        return new kwarg_const(static_cast<int64_t>(std::stoll(data)), name);
-    } else {
-        /* FLOATING */
-        return new kwarg_const(std::stod(data), name);
-    }
-}
+/// a string sink which keeps nothing; lets lex_string skip over a string
+struct null_sink {
+    void append(const char*, const char*) {}
+    void append(size_t, char) {}
+    void append(const string&) {}
+};
 
-string
-parse_string(_Iter& iter, parse_trie<string>* regs) {
+/**
+ * Lexes a quoted string into value (a std::string or a null_sink), which sees the text
+ * exactly as it would be stored.
+ */
+template <typename _Sink>
+void
+lex_string(_Iter& iter, parse_context& ctx, _Sink& value) {
     assert(*iter != '=');
     enum { SQUOTE = 0, DQUOTE = 1 };
     bool states[] { false, false };
 
     bypass_whitespace(iter, false);
-    string value;
 
     while (! eos(iter, true)) {
+        /* everything up to the next quote or '$' is copied as a single run */
+        const char* run  = iter.base();
+        const char* stop = scan::find_string_special(run, iter.end());
+
+        if (stop != run) {
+            value.append(run, stop);
+            iter.seek(stop);
+            continue;
+        }
+
         switch (*iter) {
             case '\'':
                 if (*(iter - 1) != '\\' || !states[DQUOTE]) {
@@ -261,7 +577,7 @@ parse_string(_Iter& iter, parse_trie<string>* regs) {
                         throw config_parse_exception("Unexpected $");
 
                     try {
-                        append_regs(value, iter, regs);
+                        append_regs(value, iter, ctx);
                         continue;
                     } catch (trie_lookup_error& e) {
                         //DEBUG("error " << e.what());
@@ -281,142 +597,1391 @@ no_append:
 
 exit_loop:
     ++iter;
+}
 
+string
+parse_string(_Iter& iter, parse_context& ctx) {
+    string value;
+    lex_string(iter, ctx, value);
     return value;
 }
 
-kwarg*
-parse_boolean(const string& name, _Iter& iter) {
+/**
+ * Moves iter, which points just past the '{' of a section, to just past its '}' without
+ * building anything.  Strings and macros are lexed as the parse would lex them so that
+ * braces within either are not counted.  uses_regs is set if the body reads a macro.
+ *
+ * @return false (with iter unspecified) if the body has to be parsed in place; it holds
+ *  an '@' statement, a macro which does not resolve outside of a string, a NUL or it is
+ *  never closed.
+ */
+bool
+skip_section_body(_Iter& iter, parse_context& ctx, bool& uses_regs) {
+    size_t depth = 1;
+    null_sink sink;
+
+    try {
+        for (;;) {
+            const char* ptr = scan::find_body_special(iter.base(), iter.end());
+            const char* end = iter.end();
+            iter.seek(ptr);
+
+            switch (*iter) {
+                case '{':
+                    ++depth;
+                    ++iter;
+                    break;
+
+                case '}':
+                    ++iter;
+
+                    if (0 == --depth)
+                        return true;
+
+                    break;
+
+                case '\'':
+                case '"':
+                    lex_string(iter, ctx, sink);
+
+                    if (0x0 != memchr(ptr, '$', iter.base() - ptr))
+                        uses_regs = true;
+
+                    break;
+
+                /* comments are skipped exactly as bypass_whitespace skips them */
+                case '/':
+                    if ('*' == *(iter + 1)) {
+                        const char* close = scan::find_comment_end(ptr + 1, end);
+
+                        if (0x0 == close)
+                            return false;
+
+                        iter.seek(close + 2);
+                    } else if ('/' == *(iter + 1)) {
+                        iter.seek(scan::find_line_end(ptr, end));
+                    } else {
+                        ++iter;
+                    }
+                    break;
+
+                case '$': {
+                    const bool is_bracketed = (*(iter + 1) == '{');
+                    uses_regs = true;
+
+                    try {
+                        lookup_macro(++iter, ctx);
+                    } catch (const trie_lookup_error&) {
+                        return false;
+                    }
+
+                    if (is_bracketed)
+                        ++iter;
+
+                    break;
+                }
+
+                /* '@' and NUL (or the end of the buffer) */
+                default:
+                    return false;
+            }
+        }
+    } catch (const config_parse_exception&) {
+        return false;
+    }
+}
+
+bool
+lex_boolean(_Iter& iter) {
     enum _Bool { UNDEFINED = 0, _TRUE, _FALSE };
     static parse_trie<_Bool> sbool { { "FALSE", _FALSE }, { "TRUE", _TRUE } };
 
     switch (sbool.lookup(iter)) {
         case _TRUE:
-            return new kwarg_const(true, name);
+            return true;
 
         case _FALSE:
-            return new kwarg_const(false, name);
+            return false;
 
         default:
             throw config_parse_exception("Invalid bool", iter);
     }
 }
-} // ns
 
-//////////////////////////////////////////////////////////////////////////////////////////
+kwarg*
+parse_boolean(const config_symbol* name, _Iter& iter, parse_context& ctx) {
+    note_keyword(ctx);
+    return new (ctx.arena) kwarg_const(lex_boolean(iter), name, ctx.arena);
+}
 
-config_section::config_section(const string& name)
-    : kwarg(name, kwarg::SECTION)
-{}
+enum macro_op { MACRO_UNDEFINED = 0
+              , MACRO_DEFINE
+              , MACRO_IMPORT
+              , MACRO_INCLUDE
+              , MACRO_INCLUDE_OPTIONAL };
+
+/// reads the '@' and name of a macro
+macro_op
+parse_macro_op(_Iter& iter) {
+    static parse_trie<macro_op> LUT { { "DEFINE"          , MACRO_DEFINE  }
+                                    , { "IMPORT"          , MACRO_IMPORT  }
+                                    , { "INCLUDE"         , MACRO_INCLUDE }
+                                    , { "INCLUDE_OPTIONAL", MACRO_INCLUDE_OPTIONAL }
+                                    , { "INCLUDE*"        , MACRO_INCLUDE_OPTIONAL } };
+    if ('@' != *iter)
+        throw config_parse_exception("expected ['@']", iter);
 
-config_section::~config_section() {
-    for (auto it = _M_kwargs.begin(); it != _M_kwargs.end(); ++it)
-        delete it->second;
+    try {
+        return LUT.lookup(++iter);
+    } catch (const trie_lookup_error& e) {
+        throw config_parse_exception("Invalid macro", iter, 2, 10);
+    }
 }
 
-config_section*
-config_section::section(const std::string& name) const {
-    return static_cast<config_section*>(_M_get_kwarg(name));
-}
+/// the body of an @define, following its name
+void
+parse_define(_Iter& iter, parse_context& ctx) {
+    bypass_whitespace(iter, true);
+    string name = parse_word(iter);
+    bypass_whitespace(iter, true);
 
-bool
-config_section::has_kwarg(const string& key) const {
-    return 0 != _M_kwargs.count(key);
+    if ('=' != *iter)
+        throw config_parse_exception("expected '='", iter);
+
+    assert(*iter == '=');
+    const string& value = (ctx.regs->defval(name) = parse_string(++iter, ctx));
+    note_define(ctx, name, value);
 }
 
-bool
-config_section::has_section(const string& key) const {
-    return this->has_kwarg(key) && _M_get_kwarg(key)->type() == kwarg::SECTION;
+/// the body of an @import, following its name
+void
+parse_import(_Iter& iter, parse_context& ctx) {
+    bypass_whitespace(iter, true);
+    string name  = parse_word(iter);
+    char*  value = getenv(name.c_str());
+
+    /* the result depends on the environment even if the variable is unset */
+    if (ctx.record) {
+        macro_dep dep;
+        dep.kind     = macro_dep::ENVIRON;
+        dep.token    = name;
+        dep.consumed = value ? 0 : string::npos;
+        dep.value    = value ? value : "";
+        ctx.record->deps.push_back(std::move(dep));
+    }
+
+    if (0x0 != value) {
+        stringstream ss;
+        /* it isn't obvious that you should export double quotes into the env, so we check
+         * and do it automatically */
+        if ('"' != value[0] && (! std::isdigit(value[0]) || value[0] == '$'))
+            ss << '"' << value << '"';
+        else
+            ss << value;
+
+        string data(ss.str());
+        _Iter begin(data.data(), data.data() + data.size());
+        const string& defined = (ctx.regs->defval(name) = parse_string(begin, ctx));
+        note_define(ctx, name, defined);
+    }
 }
 
-bool
-config_section::has_vector(const string& key) const {
-    return this->has_kwarg(key) && _M_get_kwarg(key)->type() == kwarg::VECTOR;
+/// the target of an @include, following its name
+string
+parse_include_path(_Iter& iter, parse_context& ctx) {
+    bypass_whitespace(iter, true);
+
+    if ('=' == *iter)
+        bypass_whitespace(++iter, true);
+
+    return parse_string(iter, ctx);
 }
+} // ns
 
-void
-config_section::_M_set_kwarg(kwarg* val) {
-    assert(val);
-    assert(val->name().size() > 0);
-    _M_kwargs[val->name()] = val;
+//////////////////////////////////////////////////////////////////////////////////////////
+// PARALLEL INCLUDES
+//////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @class include_loader
+ *
+ * Implements config::LOAD_PARALLEL.  An @include is resolved on the parsing thread and
+ * queued; a worker reads the file and, if it contains no macro of its own, parses it into
+ * a detached section against a copy of the registers as they were at the @include.  The
+ * including section drains the queue, in order, before anything else touches it.
+ *
+ * Queued work is speculative: an earlier include which had to be parsed in place may have
+ * changed the registers, in which case the later include is resolved and parsed again in
+ * place.  Either way the result is exactly that of a sequential load.
+ *
+ * With config::LOAD_CACHE_INCLUDES a subtree parsed on a worker is added to the cache as
+ * it is spliced.
+ */
+class include_loader {
+public:
+    include_loader()
+        : _M_max_threads(std::max(1u, std::thread::hardware_concurrency()))
+        , _M_stop(false)
+        , _M_snapshot_version(0)
+    {}
+
+    ~include_loader() {
+        {
+            std::lock_guard<std::mutex> lock(_M_lock);
+            _M_stop = true;
+            _M_tasks.clear();
+        }
+
+        _M_ready.notify_all();
+
+        for (auto it = _M_threads.begin(); it != _M_threads.end(); ++it)
+            it->join();
+    }
+
+    void
+    submit(config_section* target, const _Iter& path_iter, const string& path
+         , bool optional, parse_context& ctx) {
+        /* consecutive includes share one copy of the registers */
+        if (! _M_snapshot || _M_snapshot_version != ctx.regs_version) {
+            _M_snapshot.reset(new parse_trie<string>(*ctx.regs));
+            _M_snapshot_version = ctx.regs_version;
+        }
+
+        typedef std::packaged_task<unique_ptr<detached>()> task_type;
+        std::shared_ptr<task_type> task(
+                new task_type(std::bind(&include_loader::_S_parse, path, optional
+                                      , ctx.flags, 0x0 != ctx.arena, _M_snapshot
+                                      , ctx.symbols, ctx.trace)));
+
+        entry e;
+        e.target       = target;
+        e.path_iter    = path_iter;
+        e.path         = path;
+        e.optional     = optional;
+        e.regs_version = ctx.regs_version;
+        e.result       = task->get_future();
+        _M_pending.push_back(std::move(e));
+
+        {
+            std::lock_guard<std::mutex> lock(_M_lock);
+            _M_tasks.push_back([task]() { (*task)(); });
+
+            if (_M_threads.size() < _M_max_threads)
+                _M_threads.push_back(std::thread(&include_loader::_M_run, this));
+        }
+
+        _M_ready.notify_one();
+    }
+
+    void
+    drain(parse_context& ctx) {
+        while (! _M_pending.empty()) {
+            entry e = std::move(_M_pending.front());
+            _M_pending.pop_front();
+
+            const bool stale = (e.regs_version != ctx.regs_version);
+            unique_ptr<detached> res;
+
+            try {
+                res = e.result.get();
+            } catch (...) {
+                /* a stale include is loaded again below and reports its own errors */
+                if (! stale)
+                    throw;
+            }
+
+            if (! stale && res && res->root) {
+                note_source(ctx, res->abspath, true, res->hash);
+                merge_stats(ctx, res->stats);
+
+                config_section* root = res->root;
+                res->root = 0x0;
+
+                if (ctx.record)
+                    ctx.record->deps.insert(ctx.record->deps.end()
+                                          , res->record.deps.begin()
+                                          , res->record.deps.end());
+
+                if (ctx.cache) {
+                    /* the worker's arena becomes the arena of the cached variant */
+                    const std::shared_ptr<config_arena> arena(std::move(res->arena));
+                    const include_cache::entry* cached = ctx.cache->insert(
+                            res->abspath, root, arena, res->record, res->replacing);
+
+                    if (arena)
+                        ctx.arena->retain(arena);
+
+                    e.target->_M_splice(cached->root, cached->replacing, true
+                                      , ctx.replacing);
+                } else {
+                    if (res->arena)
+                        ctx.arena->adopt(std::move(res->arena));
+
+                    e.target->_M_splice(root, res->replacing, false, ctx.replacing);
+                }
+
+                continue;
+            } else if (! stale && res && res->missing) {
+                note_source(ctx, absolute_path(e.path), false, 0);
+                continue;
+            }
+
+            /* the file has macros of its own or the registers have changed since it was
+             * queued; it is parsed in place and anything it queues is drained before the
+             * includes which follow it */
+            std::deque<entry> rest;
+            rest.swap(_M_pending);
+
+            string path = e.path;
+
+            if (stale) {
+                _Iter iter = e.path_iter;
+                path = parse_string(iter, ctx);
+            }
+
+            if (ctx.cache) {
+                /* cached like any other include so that the next load can reuse it */
+                e.target->_M_include_cached(path, ctx, e.optional);
+            } else if (res && res->source && path == e.path) {
+                note_source(ctx, res->abspath, true, res->hash);
+
+                trace_scope trace(ctx.trace, "file", "parse", res->abspath);
+                stats_scope scope(ctx, res->abspath, res->source->size());
+                _Iter iter = res->source->iter();
+                e.target->_M_parse_iterator(iter, ctx);
+            } else {
+                e.target->_M_parse_file(path, ctx, e.optional);
+            }
+
+            drain(ctx);
+            _M_pending.swap(rest);
+        }
+    }
+
+    include_loader(const include_loader&) = delete;
+    include_loader& operator=(const include_loader&) = delete;
+
+private:
+    /// the outcome of reading (and possibly parsing) one include on a worker
+    struct detached {
+        detached()
+            : hash(0), root(0x0), missing(false)
+        {}
+
+        ~detached() {
+            /* an arena backed subtree is dropped along with its arena */
+            if (root && ! arena)
+                delete root;
+        }
+
+        unique_ptr<source_buffer>        source;
+        unique_ptr<config_arena>         arena;
+        string                           abspath;
+        uint64_t                         hash;
+        config_section*                  root;
+        std::unordered_set<const kwarg*> replacing;
+        include_record                   record;
+        parse_stats                      stats;
+        bool                             missing;
+    };
+
+    struct entry {
+        config_section*                     target;
+        _Iter                               path_iter;
+        string                              path;
+        bool                                optional;
+        size_t                              regs_version;
+        std::future<unique_ptr<detached>>   result;
+    };
+
+    static unique_ptr<detached>
+    _S_parse(const string& path, bool optional, int flags, bool use_arena
+           , std::shared_ptr<parse_trie<string>> regs, symbol_table* symbols
+           , config_trace* trace) {
+        unique_ptr<detached> res(new detached());
+        path_info info;
+
+        try {
+            info = get_path_info(path);
+            res->abspath = info.abspath;
+
+            trace_scope read(trace, "io", "read", res->abspath);
+            res->source.reset(new source_buffer(info.abspath, flags & config::LOAD_MMAP));
+            res->hash = content_hash(res->source->data(), res->source->size());
+        } catch (const config_io_error&) {
+            if (! optional)
+                throw config_io_error(path);
+
+            res->missing = true;
+            return res;
+        }
+
+        if (0x0 != memchr(res->source->data(), '@', res->source->size()))
+            return res;
+
+        if (use_arena)
+            res->arena.reset(new config_arena());
+
+        res->root = new (res->arena.get()) config_section(&ANONYMOUS_SYMBOL.symbol
+                                                        , res->arena.get());
+
+        parse_context ctx(regs.get(), flags, res->arena.get());
+        ctx.symbols   = symbols;
+        ctx.replacing = &res->replacing;
+        ctx.record    = &res->record;
+        ctx.stats     = &res->stats;
+        ctx.trace     = trace;
+        note_source(ctx, res->abspath, true, res->hash);
+
+        trace_scope parse(trace, "file", "parse", res->abspath);
+        stats_scope scope(ctx, res->abspath, res->source->size());
+        _Iter iter = res->source->iter();
+        res->root->_M_parse_iterator(iter, ctx);
+        return res;
+    }
+
+    void
+    _M_run() {
+        for (;;) {
+            function<void()> task;
+
+            {
+                std::unique_lock<std::mutex> lock(_M_lock);
+                _M_ready.wait(lock, [this]() { return _M_stop || ! _M_tasks.empty(); });
+
+                if (_M_tasks.empty())
+                    return;
+
+                task = std::move(_M_tasks.front());
+                _M_tasks.pop_front();
+            }
+
+            task();
+        }
+    }
+
+    const size_t                        _M_max_threads;
+    std::mutex                          _M_lock;
+    std::condition_variable             _M_ready;
+    std::deque<function<void()>>        _M_tasks;
+    std::vector<std::thread>            _M_threads;
+    bool                                _M_stop;
+
+    std::deque<entry>                   _M_pending;
+    std::shared_ptr<parse_trie<string>> _M_snapshot;
+    size_t                              _M_snapshot_version;
+};
+
+namespace {
+
+/// splices every queued include before the current section is next read or written
+void
+drain_includes(parse_context& ctx) {
+    if (ctx.includes)
+        ctx.includes->drain(ctx);
+}
+
+} // ns
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// LAZY SECTIONS
+//////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * A section body skipped by the first pass of a config::LOAD_LAZY load.  [first, last)
+ * runs from just past its '{' to just past its '}' within the source buffer [buf_begin,
+ * buf_end); .regs are the registers as they were at the '{'.
+ */
+struct lazy_body {
+    const char*             first;
+    const char*             last;
+    const char*             buf_begin;
+    const char*             buf_end;
+    parse_trie<string>*     regs;
+    lazy_loader*            loader;
+    lazy_body*              next;       /*< a later body of the same section >*/
+    std::exception_ptr      error;      /*< of the first attempt to build the section >*/
+};
+
+/**
+ * @class lazy_loader
+ *
+ * Implements config::LOAD_LAZY.  The first pass only brace matches the body of each
+ * section; the body is queued on its section, and the section is built by parsing its
+ * bodies in order the first time any of its children is read.  The loader keeps what
+ * those parses need for as long as the config lives: the source buffers, a copy of the
+ * registers for each body which reads a macro, and the bodies themselves.
+ *
+ * Bodies which define, import or include anything are parsed in place, so a deferred
+ * body never changes the registers and every copy is shared by the bodies which were
+ * skipped between two definitions.
+ *
+ * Sections are built under the loader's lock; readers on any number of threads see a
+ * single parse.  A body which fails to parse fails every read of its section.
+ */
+class lazy_loader {
+public:
+    lazy_loader(const parse_trie<string>* live, int flags, symbol_table* symbols)
+        : _M_live(live), _M_flags(flags), _M_symbols(symbols), _M_version(0)
+    {}
+
+    /**
+     * Skips the body iter points into (just past the '{') and queues it on target.
+     * @return false, leaving iter untouched, if the body has to be parsed in place
+     */
+    bool
+    defer(config_section* target, _Iter& iter, parse_context& ctx) {
+        _Iter end = iter;
+        bool uses_regs = false;
+
+        if (! skip_section_body(end, ctx, uses_regs))
+            return false;
+
+        unique_ptr<lazy_body> body(new lazy_body());
+        body->first     = iter.base();
+        body->last      = end.base();
+        body->buf_begin = iter.begin();
+        body->buf_end   = iter.end();
+        body->regs      = uses_regs ? _M_registers(ctx) : &_M_empty;
+        body->loader    = this;
+        body->next      = 0x0;
+
+        lazy_body* tail = target->_M_lazy.load(std::memory_order_relaxed);
+
+        if (0x0 == tail) {
+            target->_M_lazy.store(body.get(), std::memory_order_release);
+        } else {
+            while (tail->next)
+                tail = tail->next;
+
+            tail->next = body.get();
+        }
+
+        _M_bodies.push_back(std::move(body));
+        iter = end;
+        return true;
+    }
+
+    /// bodies deferred so far
+    size_t
+    deferred() const {
+        return _M_bodies.size();
+    }
+
+    /// keeps a buffer deferred bodies point into
+    void
+    keep(unique_ptr<source_buffer> source) {
+        _M_sources.push_back(std::move(source));
+    }
+
+    ///{@
+    /**
+     * Builds target if it still has deferred bodies.  materialize(...) is the entry of
+     * readers; build(...) is for the parse itself, which already excludes them.
+     */
+    void
+    materialize(const config_section* target) {
+        std::lock_guard<std::mutex> lock(_M_lock);
+        build(const_cast<config_section*>(target));
+    }
+
+    void
+    build(config_section* target) {
+        lazy_body* head = target->_M_lazy.load(std::memory_order_relaxed);
+
+        if (0x0 == head)
+            return;
+
+        if (head->error)
+            std::rethrow_exception(head->error);
+
+        config_trace* const tracer = config_trace::installed();
+        trace_scope trace(tracer, "section", "section", target->name());
+
+        try {
+            for (lazy_body* body = head; body; body = body->next) {
+                parse_context ctx(body->regs, _M_flags, target->_M_get_arena());
+                ctx.symbols = _M_symbols;
+                ctx.lazy    = this;
+                ctx.trace   = tracer;
+
+                _Iter iter(body->buf_begin, body->buf_end);
+                iter.seek(body->first);
+                target->_M_parse_iterator(iter, ctx);
+
+                if (iter.base() != body->last)
+                    throw config_parse_exception("unbalanced section", iter);
+            }
+        } catch (...) {
+            head->error = std::current_exception();
+            throw;
+        }
+
+        target->_M_lazy.store(0x0, std::memory_order_release);
+    }
+    ///@}
+
+    lazy_loader(const lazy_loader&) = delete;
+    lazy_loader& operator=(const lazy_loader&) = delete;
+
+private:
+    /// registers a body deferred at this point of the parse will read
+    parse_trie<string>*
+    _M_registers(const parse_context& ctx) {
+        /* a body deferred while another is built reads that body's (final) copy */
+        if (ctx.regs != _M_live)
+            return ctx.regs;
+
+        if (_M_snapshots.empty() || _M_version != ctx.regs_version) {
+            _M_snapshots.emplace_back(new parse_trie<string>(*ctx.regs));
+            _M_version = ctx.regs_version;
+        }
+
+        return _M_snapshots.back().get();
+    }
+
+    const parse_trie<string>* const _M_live;
+    const int                       _M_flags;
+    symbol_table* const             _M_symbols;
+
+    size_t                                      _M_version;
+    parse_trie<string>                          _M_empty;
+    std::vector<unique_ptr<parse_trie<string>>> _M_snapshots;
+    std::vector<unique_ptr<lazy_body>>          _M_bodies;
+    std::vector<unique_ptr<source_buffer>>      _M_sources;
+    std::mutex                                  _M_lock;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// STREAMING
+//////////////////////////////////////////////////////////////////////////////////////////
+namespace {
+
+/// unwinds the parse once a config_handler callback has returned false
+struct stream_stopped {};
+
+/**
+ * @class event_parser
+ *
+ * Implements config::stream.  The structure of each method follows the config_section
+ * method which parses the same construct into a hierarchy (::body, _M_parse_iterator;
+ * ::value, _M_parse_kwarg; ::vector, _M_parse_vector) so that both accept exactly the
+ * same text; values are lexed by the same functions and reported instead of allocated.
+ */
+class event_parser {
+public:
+    event_parser(config_handler& handler, parse_context& ctx)
+        : _M_handler(handler), _M_ctx(ctx)
+    {}
+
+    void
+    file(const string& file_path, bool optional) {
+        path_info info;
+
+        try {
+            info = get_path_info(file_path);
+        } catch (const config_io_error& e) {
+            if (! optional)
+                throw e;
+
+            return;
+        }
+
+        unique_ptr<source_buffer> source;
+
+        try {
+            source.reset(new source_buffer(info.abspath
+                                         , _M_ctx.flags & config::LOAD_MMAP));
+        } catch (const config_io_error&) {
+            if (! optional)
+                throw config_io_error(file_path);
+
+            return;
+        }
+
+        _Iter iter = source->iter();
+        body(iter);
+    }
+
+    void
+    body(_Iter& iter) {
+        while (bypass_whitespace(iter, false)) {
+            switch (*iter) {
+                case '@':
+                    macro(iter);
+                    break;
+
+                case ';':
+                case ']':
+                case ')':
+                    ++iter;
+                    break;
+
+                case '}':
+                    ++iter;
+                    return;
+
+                default:
+                    string name = parse_word(iter);
+
+                    bypass_whitespace(iter  , true);
+                    if ('=' != *iter && ':' != *iter)
+                        throw config_parse_exception("expected '=' or ':'", iter);
+                    bypass_whitespace(++iter, true);
+
+                    _M_emit(_M_handler.on_key(name));
+                    value(iter);
+                    break;
+            }
+        }
+    }
+
+    void
+    value(_Iter& iter) {
+        config_scalar scalar;
+
+        switch (*iter) {
+            case '@':
+                throw config_parse_exception("unexpected macro in value", iter);
+
+            case '\'':
+            case '"': {
+                const string data = parse_string(iter, _M_ctx);
+                scalar.type = kwarg::STRING;
+                scalar.s    = kwarg_key(data);
+                _M_emit(_M_handler.on_scalar(scalar));
+                return;
+            }
+
+            case '[':
+            case '(':
+                vector(++iter);
+                return;
+
+            case '{':
+                _M_emit(_M_handler.on_section_begin());
+                body(++iter);
+                _M_emit(_M_handler.on_section_end());
+                return;
+
+            case 'T':
+            case 't':
+            case 'F':
+            case 'f':
+                scalar.type = kwarg::BOOL;
+                scalar.b    = lex_boolean(iter);
+                break;
+
+            default: {
+                const numeric::value number = lex_number(iter, _M_ctx);
+
+                if (number.integral) {
+                    scalar.type = kwarg::INTEGRAL;
+                    scalar.i    = number.i;
+                } else {
+                    scalar.type = kwarg::FLOATING;
+                    scalar.d    = number.d;
+                }
+
+                break;
+            }
+        }
+
+        _M_emit(_M_handler.on_scalar(scalar));
+    }
+
+    void
+    vector(_Iter& iter) {
+        _M_emit(_M_handler.on_vector_begin());
+        bypass_whitespace(iter, true);
+
+        /* as with _M_parse_vector the closing bracket is left for the enclosing body */
+        while (! eos(iter, true) && ']' != *iter && ')' != *iter) {
+            if (',' == *iter)
+                ++iter;
+            else
+                value(iter);
+
+            bypass_whitespace(iter, true);
+        }
+
+        _M_emit(_M_handler.on_vector_end());
+    }
+
+    void
+    macro(_Iter& iter) {
+        switch (parse_macro_op(iter)) {
+            case MACRO_UNDEFINED:
+                break;
+
+            case MACRO_DEFINE:
+                parse_define(iter, _M_ctx);
+                break;
+
+            case MACRO_IMPORT:
+                parse_import(iter, _M_ctx);
+                break;
+
+            case MACRO_INCLUDE:
+                file(parse_include_path(iter, _M_ctx), false);
+                break;
+
+            case MACRO_INCLUDE_OPTIONAL:
+                file(parse_include_path(iter, _M_ctx), true);
+                break;
+        }
+    }
+
+private:
+    static void
+    _M_emit(bool more) {
+        if (! more)
+            throw stream_stopped();
+    }
+
+    config_handler& _M_handler;
+    parse_context&  _M_ctx;
+};
+
+} // ns
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+static_assert(offsetof(static_symbol, chars) == sizeof(config_symbol)
+            , "the characters of a symbol must follow it");
+
+/* neither is ever filed in a section index, so neither needs its hash */
+const static_symbol ROOT_SYMBOL      = { { 4, 0 }, "ROOT" };
+const static_symbol ANONYMOUS_SYMBOL = { { 0, 0 }, ""     };
+
+static_assert(sizeof(kwarg_const) == 3 * sizeof(void*)
+            , "a scalar node is a name, a type (and string size) and a value");
+
+void
+kwarg::_S_delete(kwarg* ptr) {
+    switch (ptr->type()) {
+        case kwarg::SECTION:
+            delete static_cast<config_section*>(ptr);
+            break;
+
+        case kwarg::VECTOR:
+            delete static_cast<kwarg_vector*>(ptr);
+            break;
+
+        default:
+            delete static_cast<kwarg_const*>(ptr);
+            break;
+    }
+}
+
+kwarg_const::kwarg_const(const string& data, const config_symbol* name
+                       , config_arena* arena)
+    : kwarg(name, kwarg::STRING), _M_size(static_cast<uint32_t>(data.size()))
+{
+    /* the size is kept in 32 bits; never let a longer string read back truncated */
+    if (data.size() > UINT32_MAX)
+        throw config_parse_exception("string over 4GiB [" + string(name->data()) + "]");
+
+    char* chars = static_cast<char*>(arena ? arena->allocate(data.size() + 1, 1)
+                                           : ::operator new(data.size() + 1));
+    memcpy(chars, data.data(), data.size());
+    chars[data.size()] = '\0';
+    _M_data.chars = chars;
+}
+
+kwarg_const::~kwarg_const() {
+    /* only heap nodes are destructed, and their strings are on the heap */
+    if (kwarg::STRING == type())
+        ::operator delete(const_cast<char*>(_M_data.chars));
+}
+
+kwarg_vector::kwarg_vector(const config_symbol* name, vector_type& source
+                         , config_arena* arena)
+    : kwarg(name, kwarg::VECTOR)
+    , _M_vector(std::move(source))
+    , _M_value_type(kwarg::UNDEFINED)
+    , _M_size(_M_vector.size())
+    , _M_packed(0x0)
+    , _M_arena(arena)
+    , _M_views(0x0)
+    , _M_pages(0x0)
+{
+    assert(_M_vector.get_allocator() == vector_type::allocator_type(arena));
+    source.clear();
+}
+
+kwarg_vector::kwarg_vector(const config_symbol* name, const kwarg_vector& packed
+                         , config_arena* arena)
+    : kwarg_vector(name, packed._M_value_type, packed._M_packed, packed._M_size, arena)
+{}
+
+kwarg_vector::kwarg_vector(const config_symbol* name, TYPE type, const void* data
+                         , size_t size, config_arena* arena)
+    : kwarg_vector(name, type, size, arena)
+{
+    memcpy(_M_packed, data
+         , (kwarg::BOOL == type ? sizeof(bool) : sizeof(int64_t)) * size);
+}
+
+kwarg_vector::kwarg_vector(const config_symbol* name, TYPE type, size_t size
+                         , config_arena* arena)
+    : kwarg(name, kwarg::VECTOR)
+    , _M_vector(vector_type::allocator_type(arena))
+    , _M_value_type(type)
+    , _M_size(size)
+    , _M_packed(0x0)
+    , _M_arena(arena)
+    , _M_views(0x0)
+    , _M_pages(0x0)
+{
+    assert(kwarg::INTEGRAL == type || kwarg::FLOATING == type || kwarg::BOOL == type);
+    const size_t bytes = (kwarg::BOOL == type ? sizeof(bool) : sizeof(int64_t)) * size;
+
+    _M_packed = arena ? arena->allocate(bytes, alignof(int64_t)) : ::operator new(bytes);
+}
+
+kwarg_vector::~kwarg_vector() {
+    /* the elements may be sections as well as scalars */
+    for (auto it = _M_vector.cbegin(); it != _M_vector.cend(); ++it) {
+        kwarg::_S_delete(*it);
+    }
+
+    /* the arena of a vector releases its views itself */
+    const element_views* views = _M_views.load(std::memory_order_acquire);
+
+    if (views && 0x0 == _M_arena)
+        _S_release_views(const_cast<element_views*>(views));
+
+    element_pages* pages = _M_pages.load(std::memory_order_acquire);
+
+    if (pages && 0x0 == _M_arena)
+        _S_release_pages(pages);
+
+    ::operator delete(_M_packed);
+}
+
+const kwarg_vector::vector_type*
+kwarg_vector::_M_build_views() const {
+    /* on the heap whatever the vector's arena; readers must not allocate from it */
+    element_views* built = new element_views();
+    built->storage = static_cast<kwarg_const*>(
+            ::operator new(_M_size * sizeof(kwarg_const)));
+    built->nodes.reserve(_M_size);
+
+    for (size_t i = 0; i < _M_size; ++i) {
+        _M_construct(built->storage + i, i);
+        built->nodes.push_back(built->storage + i);
+    }
+
+    /* threads which race to build the views each build a copy; the first published is
+     * kept by all of them and the others are released */
+    const element_views* views = 0x0;
+
+    if (! _M_views.compare_exchange_strong(views, built
+                                         , std::memory_order_acq_rel
+                                         , std::memory_order_acquire)) {
+        _S_release_views(built);
+        return &views->nodes;
+    }
+
+    if (_M_arena)
+        _M_arena->at_release(&kwarg_vector::_S_release_views, built);
+
+    return &built->nodes;
+}
+
+kwarg_const*
+kwarg_vector::_M_element(size_t index) const {
+    /* as with the views, racing threads each build a copy and the first published is
+     * kept; the page table and the pages are on the heap whatever the vector's arena */
+    element_pages* pages = _M_pages.load(std::memory_order_acquire);
+
+    if (0x0 == pages) {
+        element_pages* built = new element_pages;
+        built->count = (_M_size + ELEMENT_PAGE - 1) / ELEMENT_PAGE;
+        built->pages = new std::atomic<kwarg_const*>[built->count]();
+
+        if (_M_pages.compare_exchange_strong(pages, built
+                                           , std::memory_order_acq_rel
+                                           , std::memory_order_acquire)) {
+            pages = built;
+
+            if (_M_arena)
+                _M_arena->at_release(&kwarg_vector::_S_release_pages, built);
+        } else {
+            _S_release_pages(built);
+        }
+    }
+
+    std::atomic<kwarg_const*>& slot = pages->pages[index / ELEMENT_PAGE];
+    kwarg_const* page = slot.load(std::memory_order_acquire);
+
+    if (0x0 == page) {
+        const size_t first = index - index % ELEMENT_PAGE;
+        const size_t count = std::min<size_t>(ELEMENT_PAGE, _M_size - first);
+        kwarg_const* built = static_cast<kwarg_const*>(
+                ::operator new(count * sizeof(kwarg_const)));
+
+        for (size_t i = 0; i < count; ++i)
+            _M_construct(built + i, first + i);
+
+        if (slot.compare_exchange_strong(page, built
+                                       , std::memory_order_acq_rel
+                                       , std::memory_order_acquire))
+            page = built;
+        else
+            ::operator delete(built);
+    }
+
+    return page + index % ELEMENT_PAGE;
+}
+
+void
+kwarg_vector::_S_release_pages(void* ptr) {
+    element_pages* pages = static_cast<element_pages*>(ptr);
+
+    for (size_t i = 0; i < pages->count; ++i)
+        ::operator delete(pages->pages[i].load(std::memory_order_relaxed));
+
+    delete[] pages->pages;
+    delete pages;
+}
+
+void
+kwarg_vector::_M_construct(void* node, size_t index) const {
+    switch (_M_value_type) {
+        case kwarg::INTEGRAL:
+            ::new (node) kwarg_const(static_cast<const int64_t*>(_M_packed)[index]
+                                   , _M_name);
+            break;
+
+        case kwarg::FLOATING:
+            ::new (node) kwarg_const(static_cast<const double*>(_M_packed)[index]
+                                   , _M_name);
+            break;
+
+        default:
+            ::new (node) kwarg_const(static_cast<const bool*>(_M_packed)[index], _M_name);
+            break;
+    }
+}
+
+void
+kwarg_vector::_S_release_views(void* ptr) {
+    element_views* views = static_cast<element_views*>(ptr);
+
+    /* numbers and booleans own nothing, so the nodes need no destruction */
+    ::operator delete(views->storage);
+    delete views;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+config_section::config_section(const config_symbol* name, config_arena* arena)
+    : kwarg(name, kwarg::SECTION)
+    , _M_kwargs(list_type::allocator_type(arena))
+    , _M_slots(slot_type::allocator_type(arena))
+    , _M_shared(false)
+    , _M_lazy(0x0)
+{}
+
+config_section::~config_section() {
+    /* arena backed nodes are released with the arena */
+    if (_M_get_arena())
+        return;
+
+    _M_release_kwargs();
+}
+
+void
+config_section::_M_release_kwargs() {
+    assert(0x0 == _M_get_arena());
+
+    for (auto it = _M_kwargs.begin(); it != _M_kwargs.end(); ++it)
+        kwarg::_S_delete(*it);
+
+    _M_kwargs.clear();
+    _M_slots.clear();
+}
+
+void
+config_section::_M_abandon_kwargs() {
+    config_arena* arena = _M_get_arena();
+    assert(arena);
+
+    /* the old index (and the nodes it refers to) are left in the arena without being
+     * destructed */
+    new (&_M_kwargs) list_type(list_type::allocator_type(arena));
+    new (&_M_slots)  slot_type(slot_type::allocator_type(arena));
+}
+
+config_section*
+config_section::section(kwarg_key name) const {
+    CONFIG_PROFILE_NOTE(ACCESS_SECTION, name);
+    return static_cast<config_section*>(_M_get_kwarg(name));
+}
+
+bool
+config_section::has_kwarg(kwarg_key key) const {
+    CONFIG_PROFILE_NOTE(ACCESS_HAS, key);
+    return 0x0 != _M_find_kwarg(key);
+}
+
+bool
+config_section::has_section(kwarg_key key) const {
+    CONFIG_PROFILE_NOTE(ACCESS_HAS, key);
+    kwarg* ptr = _M_find_kwarg(key);
+    return 0x0 != ptr && ptr->type() == kwarg::SECTION;
+}
+
+bool
+config_section::has_vector(kwarg_key key) const {
+    CONFIG_PROFILE_NOTE(ACCESS_HAS, key);
+    kwarg* ptr = _M_find_kwarg(key);
+    return 0x0 != ptr && ptr->type() == kwarg::VECTOR;
+}
+
+kwarg*
+config_section::resolve(kwarg_key path) const {
+    const config_section* sec = this;
+    const char* it  = path.data();
+    const char* end = it + path.size();
+
+    for (;;) {
+        const char* stop = it;
+
+        while (stop != end && '.' != *stop && '[' != *stop)
+            ++stop;
+
+        kwarg* ptr = sec->_M_find_kwarg(kwarg_key(it, stop - it));
+
+        /* each index picks an element of the vector found so far, which may itself be
+         * a vector (indexed again) or a section (walked on into) */
+        while (0x0 != ptr && stop != end && '[' == *stop) {
+            if (ptr->type() != kwarg::VECTOR)
+                return 0x0;
+
+            const kwarg_vector& vec = *static_cast<kwarg_vector*>(ptr);
+            const char* digit = stop + 1;
+            size_t index = 0;
+
+            if (digit == end || ! std::isdigit(*digit))
+                return 0x0;
+
+            for (; digit != end && std::isdigit(*digit); ++digit) {
+                index = 10 * index + (*digit - '0');
+
+                if (index >= vec.size())
+                    return 0x0;
+            }
+
+            if (digit == end || ']' != *digit)
+                return 0x0;
+
+            ptr  = vec.at(index);
+            stop = digit + 1;
+        }
+
+        if (0x0 == ptr)
+            return 0x0;
+
+        if (stop == end)
+            return ptr;
+
+        if ('.' != *stop || ptr->type() != kwarg::SECTION)
+            return 0x0;
+
+        sec = static_cast<const config_section*>(ptr);
+        it  = stop + 1;
+    }
+}
+
+void
+config_section::_M_rehash(size_t capacity) {
+    assert(0 == (capacity & (capacity - 1)));
+    slot_type slots(capacity, index_slot(), _M_slots.get_allocator());
+    const size_t mask = capacity - 1;
+
+    for (size_t n = 0; n < _M_kwargs.size(); ++n) {
+        const uint32_t hash = _M_kwargs[n]->_M_name->hash;
+        size_t i = hash & mask;
+
+        while (0 != slots[i].index)
+            i = (i + 1) & mask;
+
+        slots[i].hash  = hash;
+        slots[i].index = static_cast<uint32_t>(n + 1);
+    }
+
+    _M_slots.swap(slots);
+}
+
+void
+config_section::_M_set_kwarg(kwarg* val) {
+    assert(val);
+    assert(val->_M_name->size > 0);
+
+    /* keep the load factor at or below 3/4 */
+    if (4 * (_M_kwargs.size() + 1) > 3 * _M_slots.size())
+        _M_rehash(_M_slots.empty() ? 8 : 2 * _M_slots.size());
+
+    const kwarg_key name(*val->_M_name);
+    const uint32_t hash = val->_M_name->hash;
+    const size_t mask = _M_slots.size() - 1;
+    size_t i = hash & mask;
+
+    for (; 0 != _M_slots[i].index; i = (i + 1) & mask) {
+        if (_M_slots[i].hash != hash)
+            continue;
+
+        kwarg*& ptr = _M_kwargs[_M_slots[i].index - 1];
+
+        if (ptr->name() != name)
+            continue;
+
+        /* last definition wins */
+        if (ptr != val && 0x0 == _M_get_arena())
+            kwarg::_S_delete(ptr);
+
+        ptr = val;
+        return;
+    }
+
+    _M_kwargs.push_back(val);
+    _M_slots[i].hash  = hash;
+    _M_slots[i].index = static_cast<uint32_t>(_M_kwargs.size());
+}
+
+kwarg*
+config_section::_M_find_kwarg(kwarg_key key) const {
+    _M_touch();
+    return _M_find_parsed(key);
+}
+
+kwarg*
+config_section::_M_find_parsed(kwarg_key key) const {
+    if (_M_slots.empty())
+        return 0x0;
+
+    const config_symbol* symbol = key.symbol();
+    const uint32_t hash = symbol ? symbol->hash : kwarg_hash(key.data(), key.size());
+    const size_t mask = _M_slots.size() - 1;
+
+    for (size_t i = hash & mask; 0 != _M_slots[i].index; i = (i + 1) & mask) {
+        if (_M_slots[i].hash != hash)
+            continue;
+
+        kwarg* ptr = _M_kwargs[_M_slots[i].index - 1];
+
+        /* a symbol of another config's table still matches by its characters */
+        if (ptr->_M_name == symbol || ptr->name() == key)
+            return ptr;
+    }
+
+    return 0x0;
 }
 
 kwarg*
-config_section::_M_get_kwarg(const string& key) const {
-    auto it = _M_kwargs.find(key);
+config_section::_M_get_kwarg(kwarg_key key) const {
+    kwarg* ptr = _M_find_kwarg(key);
 
-    if (it == _M_kwargs.end())
-        throw config_key_error(key);
+    if (0x0 == ptr)
+        throw config_key_error(key.str());
     else
-        return _M_kwargs.at(key);
+        return ptr;
 }
 
 kwarg*
-config_section::_M_get_kwarg(const std::string& key, kwarg::TYPE t) const {
+config_section::_M_get_kwarg(kwarg_key key, kwarg::TYPE t) const {
     kwarg* ptr = _M_get_kwarg(key);
 
-    if (! ptr->type() == t)
-        throw config_type_error(key);
+    if (ptr->type() != t)
+        throw config_type_error(key.str());
     else
         return ptr;
 }
 
 kwarg*
-config_section::_M_parse_kwarg(string key, _Iter& iter, parse_trie<string>* regs) {
+config_section::_M_parse_kwarg(const config_symbol* key, _Iter& iter
+                             , parse_context& ctx, bool element) {
     kwarg* ptr(0x0);
 
     switch (*iter) {
-        /* macro parsing */
+        /* a macro is a statement of a section body, never a value; every other case
+         * returns a node */
         case '@':
-            _M_parse_macro(iter, regs);
-            break;
+            throw config_parse_exception("unexpected macro in value", iter);
 
         /* string */
         case '\'':
         case '"':
-            ptr = new kwarg_const(parse_string(iter, regs), key);
+            ptr = new (ctx.arena) kwarg_const(parse_string(iter, ctx), key, ctx.arena);
             break;
 
         /* section vector */
         case '[':
         case '(':
-            ptr = _M_parse_vector(key, ++iter, regs);
+            ptr = _M_parse_vector(key, ++iter, ctx);
             break;
 
         /* section object */
-        case '{':
-            if (this->has_section(key))
-                ptr = this->section(key);
-            else
-                ptr = new config_section(key);
-
-            static_cast<config_section*>(ptr)->_M_parse_iterator(++iter, regs);
+        case '{': {
+            trace_scope trace(ctx.trace, "section", "section", kwarg_key(*key));
+            config_section* sec;
+
+            /* a section in a vector must not merge into (and so be freed with) the value
+             * of its key in this section, which the vector replaces */
+            kwarg* existing = element ? 0x0 : _M_find_parsed(kwarg_key(*key));
+
+            if (existing && kwarg::SECTION == existing->type()) {
+                sec = _M_writable_section(static_cast<config_section*>(existing)
+                                        , ctx.replacing);
+            } else {
+                sec = new (ctx.arena) config_section(key, ctx.arena);
+                note_kwarg(ctx, sec);
+            }
+
+            ptr = sec;
+            ++iter;
+
+            if (ctx.lazy) {
+                if (ctx.lazy->defer(sec, iter, ctx))
+                    break;
+
+                /* bodies deferred earlier come first */
+                ctx.lazy->build(sec);
+            }
+
+            sec->_M_parse_iterator(iter, ctx);
             break;
+        }
 
         /* booleans */
         case 'T':
         case 't':
         case 'F':
         case 'f':
-            ptr = parse_boolean(key, iter);
+            ptr = parse_boolean(key, iter, ctx);
             break;
 
         /* number */
         default:
-            ptr = parse_number(key, iter, regs);
+            ptr = parse_number(key, iter, ctx);
             break;
     }
 
+    /* a section is counted only when it is created rather than extended */
+    if (ptr && kwarg::SECTION != ptr->type())
+        note_kwarg(ctx, ptr);
+
     return ptr;
 };
 
 
 void
-config_section::_M_parse_iterator(_Iter& iter, parse_trie<string>* regs) {
+config_section::_M_parse_iterator(_Iter& iter, parse_context& ctx) {
     while (bypass_whitespace(iter, false)) {
         switch (*iter) {
             case '@':
-                _M_parse_macro(iter, regs);
+                _M_parse_macro(iter, ctx);
                 break;
 
             case ';':
@@ -430,181 +1995,504 @@ config_section::_M_parse_iterator(_Iter& iter, parse_trie<string>* regs) {
 
             case '}':
                 ++iter;
+                drain_includes(ctx);
                 return;
 
             default:
-                string name = parse_word(iter);
+                drain_includes(ctx);
+                const string word = parse_word(iter);
+                const config_symbol* name = ctx.symbols->intern(word.data(), word.size());
 
                 bypass_whitespace(iter  , true);
                 if ('=' != *iter && ':' != *iter)
                     throw config_parse_exception("expected '=' or ':'", iter);
                 bypass_whitespace(++iter, true);
 
-                _M_set_kwarg(_M_parse_kwarg(name, iter, regs));
+                /* a detached parse notes sections which replace a non-section value */
+                const kwarg* prior = ctx.replacing ? _M_find_parsed(kwarg_key(*name))
+                                                   : 0x0;
+                kwarg* value = _M_parse_kwarg(name, iter, ctx);
+
+                if (prior && value && kwarg::SECTION != prior->type()
+                                   && kwarg::SECTION == value->type())
+                    ctx.replacing->insert(value);
+
+                _M_set_kwarg(value);
                 break;
         }
     }
+
+    drain_includes(ctx);
 }
 
 void
-config_section::_M_parse_file(const string& file_path, parse_trie<string>* regs
+config_section::_M_parse_file(const string& file_path, parse_context& ctx
                             , bool optional) {
     path_info info;
 
     try {
         info = get_path_info(file_path);
     } catch (const config_io_error& e) {
-        if (optional)
-            return;
-        else
+        if (! optional)
             throw e;
+
+        note_source(ctx, absolute_path(file_path), false, 0);
+        return;
     }
 
-    ifstream file(info.abspath);
-    if (! file.good()) {
-        if (optional)
-            return;
-        else
+    unique_ptr<source_buffer> source;
+
+    try {
+        /* deferred bodies are parsed after the load, from a copy the file cannot change
+         * (or truncate) under them; only a mapping read before the constructor returns
+         * is safe */
+        trace_scope trace(ctx.trace, "io", "read", info.abspath);
+        source.reset(new source_buffer(info.abspath, (ctx.flags & config::LOAD_MMAP)
+                                                  && 0x0 == ctx.lazy));
+    } catch (const config_io_error&) {
+        if (! optional)
             throw config_io_error(file_path);
+
+        note_source(ctx, info.abspath, false, 0);
+        return;
     }
 
-    string data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
-    auto iter = data.begin();
+    note_source(ctx, info.abspath, true, content_hash(source->data(), source->size()));
 
-    _M_parse_iterator(iter, regs);
+    const size_t deferred = ctx.lazy ? ctx.lazy->deferred() : 0;
+    {
+        trace_scope trace(ctx.trace, "file", "parse", info.abspath);
+        stats_scope scope(ctx, info.abspath, source->size());
+        _Iter iter = source->iter();
+        _M_parse_iterator(iter, ctx);
+    }
+
+    /* deferred bodies are parsed out of the buffer later */
+    if (ctx.lazy && deferred != ctx.lazy->deferred())
+        ctx.lazy->keep(std::move(source));
 }
 
 void
-config_section::_M_parse_define(_Iter& iter, parse_trie<string>* regs) {
-    bypass_whitespace(iter, true);
-    string name = parse_word(iter);
-    bypass_whitespace(iter, true);
-
-    if ('=' != *iter)
-        throw config_parse_exception("expected '='", iter);
-
-    assert(*iter == '=');
-    regs->defval(name) = parse_string(++iter, regs);
+config_section::_M_parse_define(_Iter& iter, parse_context& ctx) {
+    drain_includes(ctx);
+    parse_define(iter, ctx);
 };
 
 void
-config_section::_M_parse_import(_Iter& iter, parse_trie<string>* regs) {
+config_section::_M_parse_import(_Iter& iter, parse_context& ctx) {
+    drain_includes(ctx);
+    parse_import(iter, ctx);
+}
+
+void
+config_section::_M_parse_include(_Iter& iter, parse_context& ctx
+                               , bool optional) {
     bypass_whitespace(iter, true);
-    string name  = parse_word(iter);
-    char*  value = getenv(name.c_str());
 
-    if (0x0 != value) {
-        stringstream ss;
-        /* it isn't obvious that you should export double quotes into the env, so we check
-         * and do it automatically */
-        if ('"' != value[0] && (! std::isdigit(value[0]) || value[0] == '$'))
-            ss << '"' << value << '"';
+    if ('=' == *iter)
+        bypass_whitespace(++iter, true);
+
+    if (0x0 == ctx.includes) {
+        if (ctx.cache)
+            _M_include_cached(parse_string(iter, ctx), ctx, optional);
         else
-            ss << value;
+            _M_parse_file(parse_string(iter, ctx), ctx, optional);
 
-        string data(ss.str());
-        auto begin = data.begin();
-        regs->defval(name) = parse_string(begin, regs);
+        return;
     }
-}
 
-void
-config_section::_M_parse_include(_Iter& iter, parse_trie<string>* regs
-                               , bool optional) {
-    bypass_whitespace(iter, true);
-    assert(*iter = '=');
-    bypass_whitespace(++iter, true);
-    string data = parse_string(iter, regs);
-    _M_parse_file(data, regs, optional);
+    const _Iter path_iter = iter;
+    string data;
+
+    try {
+        data = parse_string(iter, ctx);
+    } catch (const trie_lookup_error&) {
+        /* the macro may yet be defined by an include which is still queued */
+        iter = path_iter;
+        drain_includes(ctx);
+        data = parse_string(iter, ctx);
+    }
+
+    /* the first include of a file goes to the workers and is cached once it is spliced */
+    if (0x0 == ctx.cache || ! ctx.cache->contains(data)) {
+        ctx.includes->submit(this, path_iter, data, optional, ctx);
+        return;
+    }
+
+    /* the cached variants can only be checked against registers which are current */
+    const size_t version = ctx.regs_version;
+    drain_includes(ctx);
+
+    if (version != ctx.regs_version) {
+        _Iter again = path_iter;
+        data = parse_string(again, ctx);
+    }
+
+    _M_include_cached(data, ctx, optional);
 }
 
 void
-config_section::_M_parse_macro(_Iter& iter, parse_trie<string>* regs) {
-    enum Op { UNDEFINED = 0
-            , DEFINE
-            , IMPORT
-            , INCLUDE
-            , INCLUDE_OPTIONAL };
+config_section::_M_include_cached(const string& file_path, parse_context& ctx
+                                , bool optional) {
+    path_info info;
 
-    static parse_trie<Op> LUT { { "DEFINE"          , DEFINE  }
-                              , { "IMPORT"          , IMPORT  }
-                              , { "INCLUDE"         , INCLUDE }
-                              , { "INCLUDE_OPTIONAL", INCLUDE_OPTIONAL }
-                              , { "INCLUDE*"        , INCLUDE_OPTIONAL } };
-    if ('@' != *iter)
-        throw config_parse_exception("expected ['@']", iter);
+    try {
+        info = get_path_info(file_path);
+    } catch (const config_io_error& e) {
+        if (! optional)
+            throw e;
 
-    Op op = UNDEFINED;
+        note_source(ctx, absolute_path(file_path), false, 0);
+        return;
+    }
 
-    try {
-        op = LUT.lookup(++iter);
-    } catch (const trie_lookup_error& e) {
-        throw config_parse_exception("Invalid macro", iter, 2, 10);
+    const include_cache::entry* cached = ctx.cache->find(info.abspath, *ctx.regs);
+
+    if (0x0 == cached) {
+        include_record record;
+        std::unordered_set<const kwarg*> replacing;
+        std::shared_ptr<config_arena> arena;
+
+        if (ctx.arena)
+            arena.reset(new config_arena(include_cache::BLOCK_SIZE));
+
+        config_section* root = new (arena.get()) config_section(&ANONYMOUS_SYMBOL.symbol
+                                                              , arena.get());
+
+        parse_context sub(ctx);
+        sub.arena     = arena.get();
+        sub.replacing = &replacing;
+        sub.record    = &record;
+
+        try {
+            root->_M_parse_file(info.abspath, sub, optional);
+        } catch (...) {
+            if (! arena)
+                delete root;
+
+            throw;
+        }
+
+        ctx.regs_version = sub.regs_version;
+        merge_record(ctx, record);
+
+        cached = ctx.cache->insert(info.abspath, root, arena, record, replacing);
+    } else {
+        replay_record(ctx, cached->record);
     }
 
-    switch (op) {
-        case UNDEFINED:
+    /* nodes shared out of the variant live as long as its arena */
+    if (cached->arena)
+        ctx.arena->retain(cached->arena);
+
+    _M_splice(cached->root, cached->replacing, true, ctx.replacing);
+}
+
+void
+config_section::_M_parse_macro(_Iter& iter, parse_context& ctx) {
+    note_keyword(ctx);
+
+    switch (parse_macro_op(iter)) {
+        case MACRO_UNDEFINED:
             break;
 
-        case DEFINE:
-            _M_parse_define(iter, regs);
+        case MACRO_DEFINE: {
+            trace_scope trace(ctx.trace, "macro", "@define", NO_DETAIL);
+            _M_parse_define(iter, ctx);
             break;
+        }
 
-        case IMPORT:
-            _M_parse_import(iter, regs);
+        case MACRO_IMPORT: {
+            trace_scope trace(ctx.trace, "macro", "@import", NO_DETAIL);
+            _M_parse_import(iter, ctx);
             break;
+        }
 
-        case INCLUDE:
-            _M_parse_include(iter, regs, false);
+        case MACRO_INCLUDE: {
+            trace_scope trace(ctx.trace, "macro", "@include", NO_DETAIL);
+            _M_parse_include(iter, ctx, false);
             break;
+        }
 
-        case INCLUDE_OPTIONAL:
-            _M_parse_include(iter, regs, true);
+        case MACRO_INCLUDE_OPTIONAL: {
+            trace_scope trace(ctx.trace, "macro", "@include*", NO_DETAIL);
+            _M_parse_include(iter, ctx, true);
             break;
+        }
     }
 }
 
 kwarg*
-config_section::_M_parse_vector(string key, _Iter& iter, parse_trie<string>* regs) {
+config_section::_M_parse_vector(const config_symbol* key, _Iter& iter
+                              , parse_context& ctx) {
     bypass_whitespace(iter, true);
-    std::vector<kwarg_const*> items;
+    std::vector<vector_element> elements;
 
-    while (! eos(iter, true)) {
-        switch (*iter) {
-            case ',':
-                ++iter;
+    /* the vector packs if every element is a number, or every one a boolean */
+    kwarg::TYPE packed = kwarg::UNDEFINED;
+
+    try {
+        while (! eos(iter, true)) {
+            vector_element elem;
+
+            switch (*iter) {
+                case ',':
+                    ++iter;
+                    bypass_whitespace(iter, true);
+                    continue;
+
+                case ']':
+                case ')':
+                    goto exit_loop;
+
+                case '@':
+                case '\'':
+                case '"':
+                case '[':
+                case '(':
+                case '{':
+                    elem.type = kwarg::UNDEFINED;
+                    elem.value.node = _M_parse_kwarg(key, iter, ctx, true);
+                    break;
+
+                case 'T':
+                case 't':
+                case 'F':
+                case 'f':
+                    note_keyword(ctx);
+                    elem.type = kwarg::BOOL;
+                    elem.value.boolean = lex_boolean(iter);
+                    break;
+
+                default: {
+                    const numeric::value number = lex_number(iter, ctx);
+
+                    if (number.integral) {
+                        elem.type = kwarg::INTEGRAL;
+                        elem.value.integral = number.i;
+                    } else {
+                        elem.type = kwarg::FLOATING;
+                        elem.value.floating = number.d;
+                    }
+
+                    break;
+                }
+            }
+
+            if (kwarg::UNDEFINED != elem.type)
+                note_kwarg(ctx, elem.type);
+
+            if (elements.empty())
+                packed = elem.type;
+            else if (packed != elem.type)
+                packed = (kwarg::INTEGRAL == packed || kwarg::FLOATING == packed)
+                      && (kwarg::INTEGRAL == elem.type || kwarg::FLOATING == elem.type)
+                       ? kwarg::FLOATING : kwarg::UNDEFINED;
+
+            elements.push_back(elem);
+            bypass_whitespace(iter, true);
+        }
+exit_loop:
+        ;
+    } catch (...) {
+        /* the nodes of an arena are released with it */
+        if (0x0 == ctx.arena)
+            for (auto it = elements.begin(); it != elements.end(); ++it)
+                if (kwarg::UNDEFINED == it->type)
+                    kwarg::_S_delete(it->value.node);
+
+        throw;
+    }
+
+    if (kwarg::UNDEFINED != packed) {
+        kwarg_vector* vec = new (ctx.arena) kwarg_vector(key, packed, elements.size()
+                                                       , ctx.arena);
+
+        for (size_t i = 0; i < elements.size(); ++i) {
+            const vector_element& elem = elements[i];
+
+            if (kwarg::BOOL == packed)
+                static_cast<bool*>(vec->_M_packed)[i] = elem.value.boolean;
+            else if (kwarg::INTEGRAL == packed)
+                static_cast<int64_t*>(vec->_M_packed)[i] = elem.value.integral;
+            else if (kwarg::INTEGRAL == elem.type)
+                static_cast<double*>(vec->_M_packed)[i] = elem.value.integral;
+            else
+                static_cast<double*>(vec->_M_packed)[i] = elem.value.floating;
+        }
+
+        return vec;
+    }
+
+    /* every element becomes a node, built once and where the vector is */
+    const kwarg_vector::vector_type::allocator_type alloc(ctx.arena);
+    kwarg_vector::vector_type items(alloc);
+    items.reserve(elements.size());
+
+    for (auto it = elements.begin(); it != elements.end(); ++it) {
+        kwarg* node;
+
+        switch (it->type) {
+            case kwarg::BOOL:
+                node = new (ctx.arena) kwarg_const(it->value.boolean, key, ctx.arena);
                 break;
 
-            case ']':
-            case ')':
-                goto exit_loop;
+            case kwarg::INTEGRAL:
+                node = new (ctx.arena) kwarg_const(it->value.integral, key, ctx.arena);
+                break;
+
+            case kwarg::FLOATING:
+                node = new (ctx.arena) kwarg_const(it->value.floating, key, ctx.arena);
+                break;
 
             default:
-                items.emplace_back(
-                        static_cast<kwarg_const*>(_M_parse_kwarg(key, iter, regs))
-                        );
+                node = it->value.node;
                 break;
         }
 
-        bypass_whitespace(iter, true);
-        continue;
-exit_loop:
-        break;
+        items.push_back(static_cast<kwarg_const*>(node));
+    }
+
+    return new (ctx.arena) kwarg_vector(key, items, ctx.arena);
+}
+
+void
+config_section::_M_splice(config_section* detached
+                        , const std::unordered_set<const kwarg*>& replacing
+                        , bool share, std::unordered_set<const kwarg*>* outer) {
+    for (auto it = detached->_M_kwargs.begin(); it != detached->_M_kwargs.end(); ++it) {
+        kwarg* child = *it;
+        kwarg* existing = _M_find_parsed(child->name());
+        const bool replaces = 0 != replacing.count(child);
+
+        if (kwarg::SECTION == child->type() && ! replaces
+         && existing && kwarg::SECTION == existing->type()) {
+            _M_writable_section(static_cast<config_section*>(existing), outer)->_M_splice(
+                    static_cast<config_section*>(child), replacing, share, outer);
+            continue;
+        }
+
+        kwarg* value = share ? _M_share(child) : child;
+
+        /* when this section is itself detached the new section must go on replacing
+         * whatever it replaced here once it is spliced again */
+        if (outer && kwarg::SECTION == value->type()
+                  && (replaces || (existing && kwarg::SECTION != existing->type())))
+            outer->insert(value);
+
+        _M_set_kwarg(value);
+    }
+
+    /* the children now belong to this section */
+    if (! share && 0x0 == detached->_M_get_arena()) {
+        detached->_M_kwargs.clear();
+        delete detached;
+    }
+}
+
+config_section*
+config_section::_M_writable_section(config_section* child
+                                  , std::unordered_set<const kwarg*>* replacing) {
+    if (! child->_M_shared)
+        return child;
+
+    config_arena* arena = _M_get_arena();
+    config_section* copy = new (arena) config_section(child->_M_name, arena);
+
+    for (auto it = child->_M_kwargs.begin(); it != child->_M_kwargs.end(); ++it)
+        copy->_M_set_kwarg(_M_share(*it));
+
+    if (replacing && replacing->count(child))
+        replacing->insert(copy);
+
+    _M_set_kwarg(copy);
+    return copy;
+}
+
+kwarg*
+config_section::_M_share(kwarg* child) {
+    /* heap nodes have a single owner */
+    if (0x0 == _M_get_arena())
+        return _S_clone(child, 0x0);
+
+    if (kwarg::SECTION == child->type()) {
+        config_section* sec = static_cast<config_section*>(child);
+
+        /* never written once marked; a config_handle may share it with a live config */
+        if (! sec->_M_shared)
+            sec->_M_shared = true;
     }
 
-    return new kwarg_vector(key, items);
+    return child;
+}
+
+kwarg*
+config_section::_S_clone(const kwarg* src, config_arena* arena) {
+    auto value = [src]() { return static_cast<const kwarg_const*>(src); };
+    const config_symbol* name = src->_M_name;
+
+    switch (src->type()) {
+        case kwarg::BOOL:
+            return new (arena) kwarg_const(value()->as<bool>(), name, arena);
+
+        case kwarg::INTEGRAL:
+            return new (arena) kwarg_const(value()->as<int64_t>(), name, arena);
+
+        case kwarg::FLOATING:
+            return new (arena) kwarg_const(value()->as<double>(), name, arena);
+
+        case kwarg::STRING:
+            return new (arena) kwarg_const(value()->as<string>(), name, arena);
+
+        case kwarg::VECTOR: {
+            const kwarg_vector& vec = *static_cast<const kwarg_vector*>(src);
+
+            if (kwarg::UNDEFINED != vec.value_type())
+                return new (arena) kwarg_vector(name, vec, arena);
+
+            const kwarg_vector::vector_type::allocator_type alloc(arena);
+            kwarg_vector::vector_type items(alloc);
+            items.reserve(vec.size());
+
+            for (auto it = vec->cbegin(); it != vec->cend(); ++it)
+                items.push_back(static_cast<kwarg_const*>(_S_clone(*it, arena)));
+
+            return new (arena) kwarg_vector(name, items, arena);
+        }
+
+        default: {
+            const config_section* sec = static_cast<const config_section*>(src);
+            config_section* copy = new (arena) config_section(name, arena);
+
+            for (auto it = sec->_M_kwargs.begin(); it != sec->_M_kwargs.end(); ++it)
+                copy->_M_set_kwarg(_S_clone(*it, arena));
+
+            return copy;
+        }
+    }
 }
 
 config_section::const_iterator
 config_section::cbegin() const {
+    _M_touch();
     return _M_kwargs.cbegin();
 }
 
 config_section::const_iterator
 config_section::cend() const {
+    _M_touch();
     return _M_kwargs.cend();
 }
 
+void
+config_section::_M_materialize() const {
+    /* bodies live as long as the loader, even once another reader has built this */
+    const lazy_body* head = _M_lazy.load(std::memory_order_acquire);
+
+    if (head)
+        head->loader->materialize(this);
+}
+
 void
 config_section::dump(int depth) {
     using std::cerr;
@@ -612,46 +2500,49 @@ config_section::dump(int depth) {
     using std::setw;
     using std::setfill;
 
+    _M_touch();
+
     cerr << setfill('=') << setw(depth) << this->name() << endl;
 
     for (auto it = _M_kwargs.begin(); it != _M_kwargs.end(); ++it) {
+        const kwarg_const* value = static_cast<const kwarg_const*>(*it);
         cerr << setfill('-') << setw(4 * depth + 4);
 
-        switch (it->second->type()) {
+        switch ((*it)->type()) {
             case kwarg::FLOATING:
                 cerr << setw(18)
-                     << it->second->name()
+                     << (*it)->name()
                      << "\t"
-                     << this->get<double>(it->second->name())
+                     << value->as<double>()
                      << endl;
                 break;
 
             case kwarg::INTEGRAL:
                 cerr << setw(18)
-                     << it->second->name()
+                     << (*it)->name()
                      << "\t"
-                     << this->get<long>(it->second->name())
+                     << value->as<long>()
                      << endl;
                 break;
 
             case kwarg::STRING:
                 cerr << setw(18)
-                     << it->second->name()
+                     << (*it)->name()
                      << "\t"
-                     << this->get<string>(it->second->name())
+                     << value->as<string>()
                      << endl;
                 break;
 
             case kwarg::BOOL:
                 cerr << setw(18)
-                     << it->second->name()
+                     << (*it)->name()
                      << "\t"
-                     << (this->get<bool>(it->second->name()) ? "true" : "false")
+                     << (value->as<bool>() ? "true" : "false")
                      << endl;
                 break;
 
             case kwarg::SECTION:
-                this->section(it->first)->dump(depth + 1);
+                static_cast<config_section*>(*it)->dump(depth + 1);
                 cerr << setfill('=') << setw(depth) << this->name() << endl;
                 break;
 
@@ -666,9 +2557,9 @@ config_section::dump(int depth) {
 config* config::_S_instance(0x0);
 
 config*
-config::initialize(const string& file_path) {
+config::initialize(const string& file_path, int flags) {
     assert(0x0 == config::_S_instance);
-    _S_instance = new config(file_path);
+    _S_instance = new config(file_path, flags);
     ::atexit(config_cleanup_atexit);
     return _S_instance;
 }
@@ -679,24 +2570,292 @@ config::instance() {
 }
 #endif // defined(CONFIG_SINGLETON)
 
-config::config(const string& file_path)
-    : config_section("ROOT")
+config::config(const string& file_path, int flags)
+    : config(file_path, flags, 0x0)
+{}
+
+config::config(const string& file_path, int flags, include_cache* cache)
+    : config_section(&ROOT_SYMBOL.symbol, (flags & LOAD_ARENA) ? new config_arena() : 0x0)
+    , _M_symbols(cache ? cache->symbols() : std::make_shared<symbol_table>())
+    , _M_path_table(0x0)
+    , _M_path_count(0)
+    , _M_path_victim(0)
+    , _M_path_arena(4 * 1024)
+    , _M_arena(_M_get_arena())
 {
+    for (size_t i = 0; i < PATH_SETS * PATH_WAYS; ++i)
+        _M_path_slots[i].store(0x0, std::memory_order_relaxed);
+
+    _M_path_table.store(_M_new_path_table(PATH_SETS), std::memory_order_relaxed);
+
+    typedef std::chrono::steady_clock clock;
+    const clock::time_point begin = clock::now();
+    config_trace* const trace = config_trace::installed();
+    trace_scope load(trace, "config", "load", file_path);
+
+    try {
+        if (flags & LOAD_COMPILED) {
+            snapshot_reader reader(file_path);
+            reader.load(*this, _M_arena.get(), *_M_symbols);
+
+            config_source source;
+            source.path    = get_path_info(file_path).abspath;
+            source.present = true;
+            source.hash    = reader.hash();
+            _M_sources.push_back(source);
+
+            parse_stats::file stats;
+            stats.path  = source.path;
+            stats.bytes = reader.size();
+            _M_stats.files.push_back(stats);
+        } else {
+            path_info info = get_path_info(file_path);
+            _M_macro_regs.defval("DOT") = info.dirpath;
+
+            parse_context ctx(&_M_macro_regs, flags, _M_arena.get());
+            ctx.symbols = _M_symbols.get();
+            ctx.sources = &_M_sources;
+            ctx.stats   = &_M_stats;
+            ctx.trace   = trace;
+            unique_ptr<include_cache> local;
+            unique_ptr<include_loader> includes;
+
+            if (flags & LOAD_CACHE_INCLUDES) {
+                if (0x0 == cache) {
+                    local.reset(new include_cache(_M_symbols));
+                    cache = local.get();
+                }
+
+                cache->begin_load();
+                ctx.cache = cache;
+            }
+
+            if (flags & LOAD_PARALLEL) {
+                includes.reset(new include_loader());
+                ctx.includes = includes.get();
+            }
+
+            const int eager = LOAD_PARALLEL | LOAD_CACHE_INCLUDES;
+
+            if ((flags & LOAD_LAZY) && ! (flags & eager)) {
+                _M_lazy_loader.reset(new lazy_loader(&_M_macro_regs, flags
+                                                   , _M_symbols.get()));
+                ctx.lazy = _M_lazy_loader.get();
+            }
+
+            _M_parse_file(info.abspath, ctx);
+
+            if (ctx.cache)
+                ctx.cache->end_load();
+
+            /* a file included many times is listed once */
+            auto by_path = [](const config_source& lhs, const config_source& rhs) {
+                return lhs.path < rhs.path;
+            };
+            auto same_path = [](const config_source& lhs, const config_source& rhs) {
+                return lhs.path == rhs.path;
+            };
+
+            std::stable_sort(_M_sources.begin(), _M_sources.end(), by_path);
+            _M_sources.erase(std::unique(_M_sources.begin(), _M_sources.end(), same_path)
+                           , _M_sources.end());
+        }
+
+        const uint64_t wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                clock::now() - begin).count();
+
+        /* a compiled load is a single read */
+        if (flags & LOAD_COMPILED) {
+            _M_stats.files.back().wall_ns = wall_ns;
+            _M_stats.files.back().self_ns = wall_ns;
+        }
+
+        sum_stats(_M_stats, wall_ns);
+
+#if defined(CONFIG_PROFILE)
+        config_profile::_S_attach(this);
+#endif
+    } catch (...) {
+        /* the arena is released before the config_section base is destructed */
+        if (_M_arena)
+            _M_abandon_kwargs();
+
+        throw;
+    }
+}
+
+bool
+config::stream(const string& file_path, config_handler& handler, int flags) {
     path_info info = get_path_info(file_path);
-    _M_macro_regs.defval("DOT") = info.dirpath;
-    _M_parse_file(info.abspath, &_M_macro_regs);
+    parse_trie<string> regs;
+    regs.defval("DOT") = info.dirpath;
+
+    parse_context ctx(&regs, flags);
+    event_parser parser(handler, ctx);
+
+    try {
+        parser.file(info.abspath, false);
+    } catch (const stream_stopped&) {
+        return false;
+    }
+
+    return true;
+}
+
+config::~config() {
+#if defined(CONFIG_PROFILE)
+    config_profile::_S_detach(this);
+#endif
+
+    const string& root = _M_stats.files.empty() ? NO_DETAIL : _M_stats.files[0].path;
+    trace_scope teardown(config_trace::installed(), "config", "teardown", root);
+
+    /* the tree is released here rather than by the config_section base so that the
+     * span covers it; the lazy loader goes first, as it would have as a member */
+    _M_lazy_loader.reset();
+
+    if (_M_arena) {
+        _M_abandon_kwargs();
+        _M_arena.reset();
+    } else {
+        _M_release_kwargs();
+    }
 }
 
 bool
 config::assert_type(const string& key, kwarg::TYPE type) const {
-    const size_t index = key.find_first_of('.');
+    const kwarg* ptr = this->resolve(key);
+    return 0x0 != ptr && ptr->type() == type;
+}
 
-    /* end hierarchy */
-    if (string::npos == index)
-        return this->has_kwarg(key) && _M_get_kwarg(key)->type() == type;
+const kwarg*
+config::_M_cached_resolve(kwarg_key path) const {
+    const uint32_t hash = kwarg_hash(path.data(), path.size());
+    const std::atomic<const path_record*>* set
+            = &_M_path_slots[(hash & (PATH_SETS - 1)) * PATH_WAYS];
 
-    if (! this->has_section(key.substr(0, index)))
-        return false;
+    for (size_t i = 0; i < PATH_WAYS; ++i) {
+        const path_record* rec = set[i].load(std::memory_order_acquire);
+
+        if (0x0 != rec
+         && rec->hash == hash
+         && rec->size == path.size()
+         && 0 == memcmp(rec->data(), path.data(), path.size()))
+            return rec->ptr;
+    }
+
+    return _M_cache_path(path, hash);
+}
+
+const kwarg*
+config::_M_cache_path(kwarg_key path, uint32_t hash) const {
+    const path_record* rec = _M_find_path(path, hash);
+
+    if (0x0 == rec) {
+        /* a full cache no longer needs the lock to say so */
+        if (PATH_RECORDS > _M_path_count.load(std::memory_order_relaxed))
+            rec = _M_insert_path(path, hash);
+
+        if (0x0 == rec)
+            return this->resolve(path);
+    }
+
+    /* take an empty way of the set, else the next in turn; records are never freed
+     * before the config so readers which raced with this store still hold a valid (if
+     * different) record */
+    std::atomic<const path_record*>* set
+            = &_M_path_slots[(hash & (PATH_SETS - 1)) * PATH_WAYS];
+    size_t way = 0;
+
+    while (way < PATH_WAYS && set[way].load(std::memory_order_relaxed))
+        ++way;
+
+    if (PATH_WAYS == way)
+        way = _M_path_victim.fetch_add(1, std::memory_order_relaxed) % PATH_WAYS;
+
+    set[way].store(rec, std::memory_order_release);
+    return rec->ptr;
+}
+
+const config::path_record*
+config::_M_find_path(kwarg_key path, uint32_t hash) const {
+    /* a table which has since been outgrown is still valid, if missing a new record */
+    const path_table* table = _M_path_table.load(std::memory_order_acquire);
+    const std::atomic<const path_record*>* slots = table->slots();
+
+    for (size_t i = hash & table->mask; ; i = (i + 1) & table->mask) {
+        const path_record* rec = slots[i].load(std::memory_order_acquire);
+
+        if (0x0 == rec
+         || (rec->hash == hash && rec->size == path.size()
+          && 0 == memcmp(rec->data(), path.data(), path.size())))
+            return rec;
+    }
+}
+
+const config::path_record*
+config::_M_insert_path(kwarg_key path, uint32_t hash) const {
+    std::lock_guard<std::mutex> lock(_M_path_lock);
+
+    /* another thread may have cached the path since it was looked for */
+    const path_record* rec = _M_find_path(path, hash);
+    const size_t count = _M_path_count.load(std::memory_order_relaxed);
+
+    if (0x0 != rec || PATH_RECORDS == count)
+        return rec;
+
+    const path_table* table = _M_path_table.load(std::memory_order_relaxed);
+
+    /* keep the load factor at or below 1/2; the new table is published whole */
+    if (2 * (count + 1) > table->mask + 1) {
+        path_table* grown = _M_new_path_table(2 * (table->mask + 1));
+
+        for (size_t i = 0; i <= table->mask; ++i) {
+            const path_record* old = table->slots()[i].load(std::memory_order_relaxed);
+
+            if (0x0 == old)
+                continue;
+
+            size_t j = old->hash & grown->mask;
+
+            while (grown->slots()[j].load(std::memory_order_relaxed))
+                j = (j + 1) & grown->mask;
+
+            grown->slots()[j].store(old, std::memory_order_relaxed);
+        }
+
+        _M_path_table.store(grown, std::memory_order_release);
+        table = grown;
+    }
+
+    path_record* fresh = static_cast<path_record*>(
+            _M_path_arena.allocate(sizeof(path_record) + path.size()
+                                 , alignof(path_record)));
+    fresh->hash = hash;
+    fresh->size = static_cast<uint32_t>(path.size());
+    fresh->ptr  = this->resolve(path);
+    memcpy(const_cast<char*>(fresh->data()), path.data(), path.size());
+
+    size_t i = hash & table->mask;
+
+    while (table->slots()[i].load(std::memory_order_relaxed))
+        i = (i + 1) & table->mask;
+
+    table->slots()[i].store(fresh, std::memory_order_release);
+    _M_path_count.store(count + 1, std::memory_order_relaxed);
+    return fresh;
+}
+
+config::path_table*
+config::_M_new_path_table(size_t size) const {
+    path_table* table = static_cast<path_table*>(
+            _M_path_arena.allocate(sizeof(path_table)
+                                 + size * sizeof(std::atomic<const path_record*>)
+                                 , alignof(path_table)));
+    table->mask = size - 1;
+
+    for (size_t i = 0; i < size; ++i)
+        new (table->slots() + i) std::atomic<const path_record*>(0x0);
 
-    return this->assert_type(key.substr(index + 1), type);
+    return table;
 }
@@ -53,6 +53,13 @@ main(void) {
     assert(CFG->get<float>("EX_FLOAT_3") == 30000.0);
     assert(CFG->get<float>("EX_FLOAT_4") == 0.0);
     assert(CFG->get<double>("EX_FLOAT_5") == 3.14159);
+    assert(CFG->get<double>("EX_FLOAT_6") == 1e-3);
+    assert(CFG->get<double>("EX_FLOAT_7") == -250.0);
+    assert(CFG->get<double>("EX_FLOAT_8") == 1000.0);
+    assert(CFG->get<double>("EX_FLOAT_9") == 1.0);
+    assert(CFG->get<long>("EX_HEX_0") == 0xFFFF);
+    assert(CFG->get<long>("EX_HEX_1") == -16);
+    assert(CFG->get<long>("EX_SEP_0") == 1000000);
     assert(CFG->get<string>("string") == "Hello world");
 
     assert(CFG->has_section("object_1"));
@@ -66,11 +73,24 @@ main(void) {
         assert((*it)->as<long>() == i++);
     }
 
+    assert(CFG->vector("vector_0").value_type() == kwarg::INTEGRAL);
+    assert(CFG->vector("vector_0").span<int64_t>()[3] == 3);
+    assert(CFG->vector("vector_1").value_type() == kwarg::UNDEFINED);
+
     const kwarg_vector& vec = CFG->vector("vector_1");
     assert(vec->at(0)->as<long>() == 0);
     assert(vec->at(1)->as<double>() == 1.0);
     assert(vec->at(2)->as<string>() == "two");
     
+    assert(CFG->get_path<long>("vector_0[2]") == 2);
+    assert(CFG->get_path<string>("vector_1[2]") == "two");
+    assert(CFG->get_path<string>("object_2.object_3.string") == "Hello world");
+    assert(CFG->get_path<string>("object_2.object_3.string") == "Hello world");
+    assert(CFG->has_path("object_1.name"));
+    assert(!CFG->has_path("object_1.name.BOGUS"));
+    assert(!CFG->has_path("vector_0[4]"));
+    assert(CFG->assert_type("object_2.object_3", kwarg::SECTION));
+
     assert(CFG->get<bool >("BOGUS", true) == true);
     assert(CFG->get<long >("BOGUS", 1000) == 1000);
     assert(CFG->get<float>("BOGUS", 10.0) == 10.0);
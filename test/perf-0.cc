@@ -18,6 +18,8 @@ enum { COUNT = 10000 };
 
 static void test_cfg();
 static void test_lup();
+static void test_key();
+static void test_span();
 static void test_dat(const std::vector<int64_t>&);
 
 int 
@@ -28,6 +30,12 @@ main() {
     /* -----------------------------*/
     TEST(test_lup);
     
+    /* -----------------------------*/
+    TEST(test_key);
+
+    /* -----------------------------*/
+    TEST(test_span);
+
     /* -----------------------------*/
     {
     std::vector<int64_t> vec;
@@ -63,6 +71,31 @@ test_lup() {
     }
 }
 
+static void
+test_key() {
+    auto key = CFG->key<kwarg_vector>("data_vector");
+
+    for (size_t i = 0; i < COUNT; ++i) {
+        ssize_t Q = 0;
+        for (auto it  = key->cbegin();
+                  it != key->cend();
+                ++it) 
+            assert((*it)->as<int64_t>() == Q++);
+    }
+}
+
+static void
+test_span() {
+    config_span<int64_t> vec = CFG->vector("data_vector").span<int64_t>();
+
+    for (size_t i = 0; i < COUNT; ++i) {
+        ssize_t Q = 0;
+        for (auto it  = vec.begin();
+                  it != vec.end();
+                ++it) 
+            assert(*it == Q++);
+    }
+}
 
 static void
 test_dat(const std::vector<int64_t>& vec) {
@@ -1,6 +1,7 @@
 
 #include "config-bits.hh"
 
+#include <cassert>
 #include <iostream>
 #include <string>
 #include <memory>
@@ -40,5 +41,22 @@ main() {
     lookup_test(*k, l_1);
     lookup_test(*k, l_2);
 
+    /* longest defined prefix wins and the iterator stops right after it */
+    string l_3("WordSee}");
+    auto it = l_3.begin();
+    assert(k->lookup(it) == "TEST0");
+    assert(*it == 'e');
+
+    string l_4("{wordseesx");
+    it = l_4.begin();
+    assert(k->lookup(it) == "TEST1");
+    assert(*it == 'x');
+
+    k->defval("wor") = "TEST2";
+    string l_5("word");
+    it = l_5.begin();
+    assert(k->lookup(it) == "TEST2");
+    assert(*it == 'd');
+
     return 0;
 }
@@ -0,0 +1,152 @@
+#include "config.hh"
+#include "config-reload.hh"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+
+using namespace std;
+
+static const string DIR = "tst10.d";
+static const char*  NAMES[] = { "root", "defs", "fixed", "edited", "reader", "env"
+                              , "outer", "leaf" };
+
+static void
+write_file(const string& name, const string& text) {
+    ofstream out(DIR + "/" + name + ".cfg", ios::trunc);
+    out << text;
+}
+
+static void
+write_tree() {
+    write_file("root"  , "@include \"$DOT/defs.cfg\"\n"
+                         "fixed  = { @include \"$DOT/fixed.cfg\"  }\n"
+                         "edited = { @include \"$DOT/edited.cfg\" }\n"
+                         "reader = { @include \"$DOT/reader.cfg\" }\n"
+                         "env    = { @include \"$DOT/env.cfg\"    }\n"
+                         "nested = { @include \"$DOT/outer.cfg\"  }\n"
+                         "port   = $PORT\n");
+    write_file("defs"  , "@define PORT = \"80\"\n");
+    write_file("fixed" , "inner = { value = 1 }\n");
+    write_file("edited", "inner = { value = 1 }\n");
+    write_file("reader", "inner = { port = $PORT }\n");
+    write_file("env"   , "@import TST10_ENV\n"
+                         "inner = { value = $TST10_ENV }\n");
+    write_file("outer" , "@include \"$DOT/leaf.cfg\"\n"
+                         "own   = { value = 1 }\n");
+    write_file("leaf"  , "inner = { value = 1 }\n");
+}
+
+/// the section an include of name was spliced from
+static const config_section*
+inner(const config_handle::snapshot& cfg, const string& name) {
+    return cfg->section(name)->section("inner");
+}
+
+/**
+ * A handle which keeps its include cache only parses what changed; everything else is
+ * the subtree of the previous load, which with an arena is the very same section.  The
+ * result must match a fresh load regardless.
+ */
+static void
+run(int flags) {
+    const bool shares = flags & config::LOAD_ARENA;
+
+    write_tree();
+    setenv("TST10_ENV", "\"5\"", 1);
+
+    config_handle handle(DIR + "/root.cfg", flags);
+    const config_handle::snapshot first = handle.acquire();
+
+    assert(8 == first->sources().size());
+    assert(80 == first->get<long>("port"));
+    assert(80 == first->get_path<long>("reader.inner.port"));
+    assert(5  == first->get_path<long>("env.inner.value"));
+    assert(1  == first->get_path<long>("nested.inner.value"));
+
+    /* nothing changed; nothing is parsed again */
+    handle.reload();
+    config_handle::snapshot next = handle.acquire();
+
+    assert(8  == next->sources().size());
+    assert(80 == next->get<long>("port"));
+
+    if (shares) {
+        const char* sections[] = { "fixed", "edited", "reader", "env", "nested" };
+
+        for (size_t i = 0; i < sizeof(sections) / sizeof(*sections); ++i)
+            assert(inner(first, sections[i]) == inner(next, sections[i]));
+    }
+
+    /* an edited file */
+    write_file("edited", "inner = { value = 2 }\n");
+    handle.reload();
+    next = handle.acquire();
+
+    assert(2 == next->get_path<long>("edited.inner.value"));
+    assert(1 == first->get_path<long>("edited.inner.value"));
+    assert(! shares || inner(first, "edited") != inner(next, "edited"));
+    assert(! shares || inner(first, "fixed")  == inner(next, "fixed"));
+
+    /* a definition read by another file */
+    write_file("defs", "@define PORT = \"81\"\n");
+    handle.reload();
+    next = handle.acquire();
+
+    assert(81 == next->get<long>("port"));
+    assert(81 == next->get_path<long>("reader.inner.port"));
+    assert(! shares || inner(first, "reader") != inner(next, "reader"));
+    assert(! shares || inner(first, "fixed")  == inner(next, "fixed"));
+
+    /* the environment read by @import */
+    setenv("TST10_ENV", "\"7\"", 1);
+    handle.reload();
+    next = handle.acquire();
+
+    assert(7 == next->get_path<long>("env.inner.value"));
+    assert(! shares || inner(first, "env")   != inner(next, "env"));
+    assert(! shares || inner(first, "fixed") == inner(next, "fixed"));
+
+    /* a file included by an include */
+    write_file("leaf", "inner = { value = 2 }\n");
+    handle.reload();
+    next = handle.acquire();
+
+    assert(2 == next->get_path<long>("nested.inner.value"));
+    assert(1 == next->get_path<long>("nested.own.value"));
+    assert(! shares || inner(first, "nested") != inner(next, "nested"));
+    assert(! shares || inner(first, "fixed")  == inner(next, "fixed"));
+
+    /* the same tree as a load without the cache */
+    const config_handle::snapshot fresh = config_handle(DIR + "/root.cfg").acquire();
+    assert(fresh->get<long>("port") == next->get<long>("port"));
+
+    const char* paths[] = { "fixed.inner.value", "edited.inner.value", "reader.inner.port"
+                          , "env.inner.value", "nested.inner.value", "nested.own.value" };
+
+    for (size_t i = 0; i < sizeof(paths) / sizeof(*paths); ++i)
+        assert(fresh->get_path<long>(paths[i]) == next->get_path<long>(paths[i]));
+}
+
+int
+main() {
+    mkdir(DIR.c_str(), 0755);
+
+    const int cached = config::LOAD_CACHE_INCLUDES;
+    run(cached);
+    run(cached | config::LOAD_ARENA);
+    run(cached | config::LOAD_PARALLEL);
+    run(cached | config::LOAD_PARALLEL | config::LOAD_ARENA);
+
+    for (size_t i = 0; i < sizeof(NAMES) / sizeof(*NAMES); ++i)
+        remove((DIR + "/" + NAMES[i] + ".cfg").c_str());
+
+    rmdir(DIR.c_str());
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include "config.hh"
+#include "config-sax.hh"
+
+#include <cassert>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+using namespace std;
+
+/**
+ * Flattens the event stream into "path -> value", applying "last definition wins" as the
+ * hierarchy does, so that it can be checked against config::instance().
+ */
+class flatten : public config_handler {
+public:
+    map<string, config_scalar> scalars;
+    map<string, string>        strings;
+    size_t                     sections = 0;
+    size_t                     vectors  = 0;
+
+    bool
+    on_key(kwarg_key name) {
+        _M_key = name.str();
+        return true;
+    }
+
+    bool
+    on_scalar(const config_scalar& value) {
+        const string path = _M_path();
+        scalars[path] = value;
+
+        if (kwarg::STRING == value.type)
+            strings[path] = value.s.str();
+
+        return true;
+    }
+
+    bool
+    on_section_begin() {
+        _M_stack.push_back(frame(_M_path(), false));
+        ++sections;
+        return true;
+    }
+
+    bool
+    on_section_end() {
+        _M_stack.pop_back();
+        return true;
+    }
+
+    bool
+    on_vector_begin() {
+        _M_stack.push_back(frame(_M_path(), true));
+        ++vectors;
+        return true;
+    }
+
+    bool
+    on_vector_end() {
+        _M_stack.pop_back();
+        return true;
+    }
+
+private:
+    struct frame {
+        frame(const string& path, bool is_vector)
+            : path(path), is_vector(is_vector), index(0)
+        {}
+
+        string path;
+        bool   is_vector;
+        size_t index;
+    };
+
+    string
+    _M_path() {
+        if (_M_stack.empty())
+            return _M_key;
+
+        frame& top = _M_stack.back();
+
+        if (top.is_vector) {
+            stringstream ss;
+            ss << top.path << "[" << top.index++ << "]";
+            return ss.str();
+        }
+
+        return top.path + "." + _M_key;
+    }
+
+    string          _M_key;
+    vector<frame>   _M_stack;
+};
+
+/// stops at the first assignment of one key
+class find_key : public config_handler {
+public:
+    find_key(const string& key)
+        : _M_key(key), _M_found(false), value(0), events(0)
+    {}
+
+    bool
+    on_key(kwarg_key name) {
+        ++events;
+        _M_found = (name.str() == _M_key);
+        return true;
+    }
+
+    bool
+    on_scalar(const config_scalar& scalar) {
+        ++events;
+
+        if (! _M_found)
+            return true;
+
+        value = scalar.i;
+        return false;
+    }
+
+private:
+    const string _M_key;
+    bool         _M_found;
+
+public:
+    long   value;
+    size_t events;
+};
+
+int
+main() {
+    config::initialize("test/example.cfg");
+
+    for (int flags = config::LOAD_DEFAULT; flags <= config::LOAD_MMAP; ++flags) {
+        flatten events;
+        assert(config::stream("test/example.cfg", events, flags));
+
+        assert(events.sections == 3);
+        assert(events.vectors  == 2);
+        assert(events.scalars.size() > 30);
+
+        /* every value streamed is the value in the hierarchy */
+        for (auto it = events.scalars.begin(); it != events.scalars.end(); ++it) {
+            const string& path = it->first;
+
+            switch (it->second.type) {
+                case kwarg::BOOL:
+                    assert(CFG->get_path<bool>(path) == it->second.b);
+                    break;
+
+                case kwarg::INTEGRAL:
+                    assert(CFG->get_path<long>(path) == it->second.i);
+                    break;
+
+                case kwarg::FLOATING:
+                    assert(CFG->get_path<double>(path) == it->second.d);
+                    break;
+
+                case kwarg::STRING:
+                    assert(CFG->get_path<string>(path) == events.strings[path]);
+                    break;
+
+                default:
+                    assert(false);
+            }
+        }
+
+        assert(events.strings["EX_STRING_4"] == "amacro-args_1NotBashLike");
+        assert(events.scalars["EX_LONG_3"].i == 30000);
+        assert(events.scalars["vector_1[1]"].type == kwarg::FLOATING);
+        assert(events.strings["object_2.object_3.string"] == "Hello world");
+    }
+
+    /* a handler may stop as soon as it has what it needs */
+    find_key port("EX_LONG_2");
+    assert(! config::stream("test/example.cfg", port));
+    assert(port.value == 3000);
+
+    find_key none("no_such_key");
+    assert(config::stream("test/example.cfg", none));
+    assert(none.events > port.events);
+
+    /* a macro is not a value; rejected as the hierarchy rejects it */
+    flatten rejected;
+
+    try {
+        config::stream("test/tst3-macro.cfg", rejected);
+        assert(false);
+    } catch (const config_parse_exception& e) {
+        assert(string::npos != string(e.what()).find("unexpected macro in value"));
+    }
+
+    assert(0 == rejected.scalars.count("values[1]"));
+
+    return 0;
+}
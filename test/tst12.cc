@@ -0,0 +1,163 @@
+#include "config.hh"
+#include "config-reload.hh"
+
+#include <unistd.h>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+
+/// a config built outside of the singleton
+static config_handle::snapshot
+load(const string& path, int flags) {
+    return config_handle(path, flags).acquire();
+}
+
+/// true if both sections hold the same children, with the same values, in the same order
+static bool
+same(const config_section& lhs, const config_section& rhs) {
+    if (lhs.size() != rhs.size())
+        return false;
+
+    for (auto l = lhs.cbegin(), r = rhs.cbegin(); l != lhs.cend(); ++l, ++r) {
+        const kwarg& a = **l;
+        const kwarg& b = **r;
+
+        if (a.name() != b.name() || a.type() != b.type())
+            return false;
+
+        switch (a.type()) {
+            case kwarg::SECTION:
+                if (! same(static_cast<const config_section&>(a)
+                         , static_cast<const config_section&>(b)))
+                    return false;
+                break;
+
+            case kwarg::VECTOR: {
+                const kwarg_vector& va = static_cast<const kwarg_vector&>(a);
+                const kwarg_vector& vb = static_cast<const kwarg_vector&>(b);
+
+                if (va->size() != vb->size())
+                    return false;
+
+                for (size_t i = 0; i < va->size(); ++i)
+                    if (va->at(i)->as<string>() != vb->at(i)->as<string>())
+                        return false;
+                break;
+            }
+
+            default:
+                if (static_cast<const kwarg_const&>(a).as<string>()
+                 != static_cast<const kwarg_const&>(b).as<string>())
+                    return false;
+                break;
+        }
+    }
+
+    return true;
+}
+
+static void
+run(int flags) {
+    const config_handle::snapshot eager = load("test/tst12.cfg", flags);
+    const config_handle::snapshot lazy  = load("test/tst12.cfg", flags | config::LOAD_LAZY);
+
+    /* each section sees the macros as they were where it was written */
+    assert(80  == lazy->get_path<long>("server.port"));
+    assert(801 == lazy->get_path<long>("server.backup"));
+    assert(81  == lazy->get_path<long>("client.port"));
+    assert("local.domain" == lazy->get_path<string>("server.host"));
+    assert("local" == lazy->get_path<string>("client.nested.deeper.value"));
+    assert("} {" == lazy->get_path<string>("server.braces"));
+    assert("{ $HOST }" == lazy->get_path<string>("server.quoted"));
+
+    /* reopened sections, in order */
+    const config_section* merged = lazy->section("merged");
+    assert(5 == merged->size());
+    assert(2 == merged->get<long>("b"));
+    assert(3 == merged->get<long>("c"));
+    assert(merged->section("inner")->has_kwarg("x"));
+    assert(merged->section("inner")->has_kwarg("y"));
+    assert(5 == lazy->get<long>("replaced"));
+    assert(0 == lazy->section("empty")->size());
+
+    assert(same(*eager, *lazy));
+}
+
+int
+main() {
+    run(config::LOAD_DEFAULT);
+    run(config::LOAD_ARENA);
+    run(config::LOAD_MMAP | config::LOAD_ARENA);
+
+    /* a section is only parsed once it is read */
+    try {
+        load("test/tst12-bad.cfg", config::LOAD_DEFAULT);
+        assert(false);
+    } catch (const config_parse_exception&) {
+    }
+
+    const config_handle::snapshot bad = load("test/tst12-bad.cfg", config::LOAD_LAZY);
+    assert(1 == bad->get_path<long>("good.value"));
+    assert(bad->has_section("bad"));
+
+    for (int i = 0; i < 2; ++i) {
+        try {
+            bad->section("bad")->get<long>("value");
+            assert(false);
+        } catch (const config_parse_exception&) {
+        }
+    }
+
+
+    /* deferred bodies are parsed from the text as loaded, whatever becomes of the file */
+    {
+        const string file = "/tmp/tst12-edit.cfg";
+        ofstream(file) << "server = { port = 80 host = \"local\" }\n";
+
+        const config_handle::snapshot cfg = load(file
+                                               , config::LOAD_LAZY | config::LOAD_MMAP);
+
+        {
+            fstream edit(file, ios::in | ios::out);
+            edit.seekp(18);
+            edit << "99";
+        }
+
+        assert(80 == cfg->section("server")->get<long>("port"));
+
+        const config_handle::snapshot truncated = load(file
+                                                     , config::LOAD_LAZY
+                                                     | config::LOAD_MMAP);
+        assert(0 == truncate(file.c_str(), 0));
+        assert(99 == truncated->section("server")->get<long>("port"));
+        assert("local" == truncated->section("server")->get<string>("host"));
+
+        remove(file.c_str());
+    }
+
+
+    /* readers racing to build the same sections see a single parse */
+    const config_handle::snapshot shared = load("test/tst12.cfg"
+                                              , config::LOAD_LAZY | config::LOAD_ARENA);
+    vector<thread> readers;
+
+    for (int i = 0; i < 8; ++i) {
+        readers.push_back(thread([shared]() {
+            assert(80 == shared->section("server")->get<long>("port"));
+            assert(4  == shared->section("server")->section("limits")->get<long>("mem"));
+            assert(5  == shared->section("merged")->size());
+        }));
+    }
+
+    for (auto it = readers.begin(); it != readers.end(); ++it)
+        it->join();
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include "config.hh"
+#include "config-reload.hh"
+
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+using namespace std;
+
+static bool
+ends_with(const string& str, const string& suffix) {
+    return str.size() >= suffix.size()
+        && 0 == str.compare(str.size() - suffix.size(), suffix.size(), suffix);
+}
+
+/// the files of tst6.cfg, in the order their parse begins
+static const char* FILES[] = { "/tst6.cfg", "/tst6-a.cfg", "/tst6-b.cfg", "/tst6-c.cfg"
+                             , "/tst6-a.cfg", "/tst6-c.cfg" };
+
+static void
+check_files(const parse_stats& stats) {
+    assert(6 == stats.files.size());
+
+    for (size_t i = 0; i < stats.files.size(); ++i) {
+        const parse_stats::file& file = stats.files[i];
+
+        assert(ends_with(file.path, FILES[i]));
+        assert((0 == i ? 0 : 1) == file.include_depth);
+        assert(file.bytes > 0);
+        assert(file.self_ns <= file.wall_ns);
+    }
+
+    assert(1 == stats.total.include_depth);
+    assert(stats.total.wall_ns >= stats.files[0].wall_ns);
+}
+
+int
+main() {
+    const config_handle::snapshot cfg = config_handle("test/tst6.cfg").acquire();
+    const parse_stats& stats = cfg->stats();
+    check_files(stats);
+
+    /* sections which already exist are merged into rather than created */
+    const parse_stats::file& merged = stats.files[1];
+    assert(6 == merged.kwargs);
+    assert(1 == merged.sections);
+    assert(0 == merged.vectors);
+
+    const parse_stats::file& nested = stats.files[4];
+    assert(8 == nested.kwargs);
+    assert(3 == nested.sections);
+
+    /* two @define and $GREETING */
+    assert(2 == stats.files[2].trie_lookups);
+    assert(1 == stats.files[3].macro_expansions);
+    assert(1 == stats.files[3].trie_lookups);
+
+    /* 2 @define and 6 @include, ${DOT} once, $DIR six times and $SUB once */
+    const parse_stats::file& root = stats.files[0];
+    assert(8 == root.kwargs);
+    assert(4 == root.sections);
+    assert(8 == root.macro_expansions);
+    assert(16 == root.trie_lookups);
+
+    /* every nanosecond of the root is spent in exactly one file */
+    uint64_t self_ns = 0;
+    uint64_t kwargs  = 0;
+    uint64_t bytes   = 0;
+
+    for (auto it = stats.files.begin(); it != stats.files.end(); ++it) {
+        self_ns += it->self_ns;
+        kwargs  += it->kwargs;
+        bytes   += it->bytes;
+    }
+
+    assert(self_ns == root.wall_ns);
+    assert(self_ns == stats.total.self_ns);
+    assert(kwargs  == stats.total.kwargs);
+    assert(bytes   == stats.total.bytes);
+
+    /* the same files when the includes are parsed on workers */
+    check_files(config_handle("test/tst6.cfg", config::LOAD_PARALLEL).acquire()->stats());
+
+    /* a reused include is not parsed again */
+    const config_handle::snapshot cached = config_handle("test/tst6.cfg"
+                                                        , config::LOAD_CACHE_INCLUDES)
+                                                    .acquire();
+    assert(4 == cached->stats().files.size());
+    assert(cached->stats().total.bytes < stats.total.bytes);
+
+    /* each vector counts once, however many elements it holds */
+    assert(2 == config_handle("test/example.cfg").acquire()->stats().total.vectors);
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include "config.hh"
+#include "config-reload.hh"
+#include "config-trace.hh"
+
+#include <unistd.h>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+
+using namespace std;
+
+struct event {
+    string name;
+    string detail;
+    string tid;
+};
+
+/// the value of "field": in an event written by config_trace
+static string
+field(const string& line, const string& name) {
+    const string key = "\"" + name + "\":";
+    const size_t pos = line.find(key);
+    assert(string::npos != pos);
+
+    size_t begin = pos + key.size();
+    size_t end;
+
+    if ('"' == line[begin])
+        end = line.find('"', ++begin);
+    else
+        end = line.find_first_of(",}", begin);
+
+    return line.substr(begin, end - begin);
+}
+
+static vector<event>
+read_trace(const string& path) {
+    ifstream in(path);
+    vector<event> events;
+    string line;
+
+    getline(in, line);
+    assert("[" == line);
+
+    while (getline(in, line) && "]" != line) {
+        assert('{' == line[0]);
+        assert("X" == field(line, "ph"));
+
+        event e;
+        e.name   = field(line, "name");
+        e.detail = field(line, "detail");
+        e.tid    = field(line, "tid");
+        events.push_back(e);
+    }
+
+    assert("]" == line);
+    return events;
+}
+
+static size_t
+count(const vector<event>& events, const string& name, const string& suffix = "") {
+    size_t n = 0;
+
+    for (auto it = events.begin(); it != events.end(); ++it) {
+        const string& d = it->detail;
+
+        if (name == it->name && d.size() >= suffix.size()
+                             && 0 == d.compare(d.size() - suffix.size(), suffix.size()
+                                             , suffix))
+            ++n;
+    }
+
+    return n;
+}
+
+int
+main() {
+    const string path = "/tmp/tst14-" + to_string(getpid()) + ".json";
+    {
+        config_trace trace(path);
+        config_trace::install(&trace);
+
+        /* a sequential load of tst6.cfg, torn down within the trace */
+        config_handle("test/tst6.cfg").acquire();
+
+        config_trace::install(0x0);
+        config_handle("test/example.cfg").acquire();
+    }
+
+    vector<event> events = read_trace(path);
+
+    assert(1 == count(events, "load"));
+    assert(1 == count(events, "teardown", "/tst6.cfg"));
+    assert(1 == count(events, "parse", "/tst6.cfg"));
+    assert(2 == count(events, "parse", "/tst6-a.cfg"));
+    assert(2 == count(events, "read" , "/tst6-a.cfg"));
+    assert(1 == count(events, "parse", "/tst6-b.cfg"));
+    assert(2 == count(events, "parse", "/tst6-c.cfg"));
+    assert(0 == count(events, "parse", "/example.cfg"));
+
+    /* the missing @include* is looked for, but there is nothing to read */
+    assert(0 == count(events, "read", "/tst6-missing.cfg"));
+    assert(5 == count(events, "@include"));
+    assert(1 == count(events, "@include*"));
+    assert(4 == count(events, "@define"));
+    assert(count(events, "section", "service") >= 2);
+    assert(1 == count(events, "section", "nested"));
+
+    /* includes handed to workers are parsed on a thread of their own */
+    {
+        config_trace trace(path);
+        config_trace::install(&trace);
+        config_handle("test/tst6.cfg", config::LOAD_PARALLEL).acquire();
+    }
+
+    events = read_trace(path);
+    assert(0x0 == config_trace::installed());
+
+    /* the third @include is queued as tst6-a.cfg before b redefines SUB; that parse is
+     * discarded */
+    assert(3 == count(events, "parse", "/tst6-a.cfg"));
+    assert(2 == count(events, "parse", "/tst6-c.cfg"));
+
+    set<string> tids;
+
+    for (auto it = events.begin(); it != events.end(); ++it)
+        tids.insert(it->tid);
+
+    assert(tids.size() > 1);
+
+    /* a lazy section is recorded when it is built */
+    {
+        config_trace trace(path);
+        config_handle handle("test/tst6.cfg", config::LOAD_LAZY);
+        config_handle::snapshot cfg = handle.acquire();
+
+        config_trace::install(&trace);
+        assert(8080 == cfg->section("service")->get<long>("port"));
+        config_trace::install(0x0);
+    }
+
+    events = read_trace(path);
+    assert(1 == count(events, "section", "service"));
+
+    remove(path.c_str());
+    return 0;
+}
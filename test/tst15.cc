@@ -0,0 +1,111 @@
+#include "config.hh"
+#include "config-profile.hh"
+#include "config-reload.hh"
+
+#include <cassert>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+
+/// calls of access on key, from any caller
+static uint64_t
+calls(config_access access, const string& key) {
+    const vector<config_profile::entry> entries = config_profile::top();
+    uint64_t n = 0;
+
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (access == it->access && key == it->key)
+            n += it->calls;
+    }
+
+    return n;
+}
+
+/// call sites of access on key
+static size_t
+callers(config_access access, const string& key) {
+    const vector<config_profile::entry> entries = config_profile::top();
+    size_t n = 0;
+
+    for (auto it = entries.begin(); it != entries.end(); ++it)
+        n += (access == it->access && key == it->key);
+
+    return n;
+}
+
+static long
+per_packet(const config& cfg, int packets) {
+    long sum = 0;
+
+    for (int i = 0; i < packets; ++i)
+        sum += cfg.section("nested")->section("service")->get<long>("port");
+
+    return sum;
+}
+
+int
+main() {
+    const config_handle::snapshot cfg = config_handle("test/tst6.cfg").acquire();
+
+    assert(8080 * 1000 == per_packet(*cfg, 1000));
+
+#if ! defined(CONFIG_PROFILE)
+    /* nothing is counted unless the library and this test are built to profile */
+    assert(0 == calls(ACCESS_GET, "nested.service.port"));
+    assert(0 == callers(ACCESS_GET, "nested.service.port"));
+    assert(config_profile::top().empty());
+#else
+    assert(1000 == calls(ACCESS_SECTION, "nested"));
+    assert(1000 == calls(ACCESS_SECTION, "nested.service"));
+    assert(1000 == calls(ACCESS_GET    , "nested.service.port"));
+
+    /* the hottest lookups come first */
+    const vector<config_profile::entry> top = config_profile::top(3);
+    assert(3 == top.size());
+
+    for (auto it = top.begin(); it != top.end(); ++it)
+        assert(1000 == it->calls);
+
+    /* each accessor is counted under its own name */
+    const config_section* limits = cfg->section("service")->section("limits");
+    assert(7 == limits->get<long>("threads", 7));
+    assert(! limits->has_kwarg("threads"));
+    assert(1 == cfg->get_path<long>("service.limits.cpu"));
+
+    assert(1 == calls(ACCESS_GET_DEFAULT, "service.limits.threads"));
+    assert(1 == calls(ACCESS_HAS        , "service.limits.threads"));
+    assert(1 == calls(ACCESS_GET_PATH   , "service.limits.cpu"));
+
+    /* a second call site of the same key is reported apart */
+    assert(8080 == cfg->section("nested")->section("service")->get<long>("port"));
+    assert(1001 == calls(ACCESS_GET, "nested.service.port"));
+    assert(2 == callers(ACCESS_GET, "nested.service.port"));
+
+    /* every thread is counted */
+    thread other([&cfg]() { per_packet(*cfg, 10); });
+    other.join();
+    assert(1011 == calls(ACCESS_GET, "nested.service.port"));
+
+    /* a config which is destroyed keeps its calls under the keys it qualified */
+    {
+        const config_handle::snapshot gone = config_handle("test/tst6-b.cfg").acquire();
+        assert(2 == gone->get<long>("b_value"));
+    }
+
+    assert(1 == calls(ACCESS_GET, "b_value"));
+
+    stringstream report;
+    config_profile::report(report, 1);
+    assert(string::npos != report.str().find("nested"));
+
+    config_profile::reset();
+    assert(config_profile::top().empty());
+#endif
+
+    return 0;
+}
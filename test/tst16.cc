@@ -0,0 +1,103 @@
+#include "config.hh"
+#include "config-reload.hh"
+
+#include <cassert>
+#include <cstdio>
+#include <string>
+
+
+using namespace std;
+
+/**
+ * Checks that every node below section names itself with a symbol of cfg's table.
+ * @return the number of nodes
+ */
+static size_t
+check_names(const config& cfg, const config_section& section) {
+    size_t nodes = 0;
+
+    for (auto it = section.cbegin(); it != section.cend(); ++it) {
+        const kwarg_key name = (*it)->name();
+
+        assert(0x0 != name.symbol());
+        assert(name.symbol() == cfg.intern(name.str()).symbol());
+        assert('\0' == name.data()[name.size()]);
+        ++nodes;
+
+        if (kwarg::SECTION == (*it)->type())
+            nodes += check_names(cfg, *static_cast<const config_section*>(*it));
+    }
+
+    return nodes;
+}
+
+static kwarg_key
+child_name(const config_section* section, const string& name) {
+    for (auto it = section->cbegin(); it != section->cend(); ++it)
+        if ((*it)->name() == name)
+            return (*it)->name();
+
+    assert(false);
+    return kwarg_key("");
+}
+
+static void
+check(const config_handle::snapshot& cfg) {
+    const size_t nodes = check_names(*cfg, *cfg);
+
+    /* port, limits, x, y, ... are each stored once */
+    assert(cfg->symbols().size() < nodes);
+    assert(cfg->symbols().bytes() > 0);
+
+    /* the same name in two sections is the same characters */
+    const config_section* service = cfg->section("nested")->section("service");
+    const kwarg_key port   = child_name(cfg->section("service"), "port");
+    const kwarg_key nested = child_name(service, "port");
+    assert(port.symbol() == nested.symbol());
+    assert(port.data() == nested.data());
+
+    /* an interned key finds its node without comparing characters */
+    const kwarg_key x = cfg->intern("x");
+    assert(0x0 != x.symbol());
+    assert(10 == cfg->get<int>(x));
+    assert(1 == cfg->section("nested")->get<int>(x));
+    assert(x == "x");
+    assert("x" == string(x));
+
+    /* a name no node has is not interned */
+    const kwarg_key missing = cfg->intern("missing");
+    assert(0x0 == missing.symbol());
+    assert(! cfg->has_kwarg(missing));
+}
+
+int
+main() {
+    const int flags[] = { config::LOAD_DEFAULT
+                        , config::LOAD_ARENA
+                        , config::LOAD_PARALLEL
+                        , config::LOAD_PARALLEL | config::LOAD_ARENA
+                        , config::LOAD_CACHE_INCLUDES
+                        , config::LOAD_CACHE_INCLUDES | config::LOAD_ARENA
+                        , config::LOAD_LAZY };
+
+    for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i)
+        check(config_handle("test/tst6.cfg", flags[i]).acquire());
+
+    /* a snapshot interns the names it is rebuilt with */
+    const string compiled = "/tmp/tst16.snapshot";
+    config_handle("test/tst6.cfg").acquire()->compile(compiled);
+    check(config_handle(compiled, config::LOAD_COMPILED).acquire());
+    remove(compiled.c_str());
+
+    /* a reload which splices from the include cache shares its symbols */
+    config_handle handle("test/tst6.cfg"
+                       , config::LOAD_CACHE_INCLUDES | config::LOAD_ARENA);
+    const config_handle::snapshot before = handle.acquire();
+    handle.reload();
+    const config_handle::snapshot after = handle.acquire();
+
+    assert(&before->symbols() == &after->symbols());
+    check(after);
+
+    return 0;
+}
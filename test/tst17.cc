@@ -0,0 +1,219 @@
+#include "config.hh"
+#include "config-reload.hh"
+
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <type_traits>
+
+
+using namespace std;
+
+/**
+ * Live heap allocations, so that a load can be seen to free all it allocated, and all
+ * those ever made.  Every form of the global operators is replaced, so that each
+ * allocation is counted once and freed by the same allocator which made it.
+ */
+static std::atomic<long> live(0);
+static std::atomic<long> made(0);
+
+static void*
+counted_alloc(size_t size, size_t align = 0) {
+    void* ptr = 0x0;
+
+    if (0 == align)
+        ptr = malloc(size ? size : 1);
+    else if (0 != posix_memalign(&ptr, align < sizeof(void*) ? sizeof(void*) : align
+                                     , size ? size : 1))
+        ptr = 0x0;
+
+    if (ptr) {
+        ++live;
+        ++made;
+    }
+
+    return ptr;
+}
+
+static void
+counted_free(void* ptr) noexcept {
+    if (ptr) {
+        --live;
+        free(ptr);
+    }
+}
+
+void* operator new(size_t size) {
+    void* ptr = counted_alloc(size);
+
+    if (0x0 == ptr)
+        throw bad_alloc();
+
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{ return operator new(size); }
+
+void* operator new(size_t size, const nothrow_t&) noexcept
+{ return counted_alloc(size); }
+
+void* operator new[](size_t size, const nothrow_t&) noexcept
+{ return counted_alloc(size); }
+
+void operator delete(void* ptr) noexcept
+{ counted_free(ptr); }
+
+void operator delete[](void* ptr) noexcept
+{ counted_free(ptr); }
+
+void operator delete(void* ptr, const nothrow_t&) noexcept
+{ counted_free(ptr); }
+
+void operator delete[](void* ptr, const nothrow_t&) noexcept
+{ counted_free(ptr); }
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* ptr, size_t) noexcept
+{ counted_free(ptr); }
+
+void operator delete[](void* ptr, size_t) noexcept
+{ counted_free(ptr); }
+#endif
+
+#if defined(__cpp_aligned_new)
+void* operator new(size_t size, align_val_t align) {
+    void* ptr = counted_alloc(size, static_cast<size_t>(align));
+
+    if (0x0 == ptr)
+        throw bad_alloc();
+
+    return ptr;
+}
+
+void* operator new[](size_t size, align_val_t align)
+{ return operator new(size, align); }
+
+void* operator new(size_t size, align_val_t align, const nothrow_t&) noexcept
+{ return counted_alloc(size, static_cast<size_t>(align)); }
+
+void* operator new[](size_t size, align_val_t align, const nothrow_t&) noexcept
+{ return counted_alloc(size, static_cast<size_t>(align)); }
+
+void operator delete(void* ptr, align_val_t) noexcept
+{ counted_free(ptr); }
+
+void operator delete[](void* ptr, align_val_t) noexcept
+{ counted_free(ptr); }
+
+void operator delete(void* ptr, size_t, align_val_t) noexcept
+{ counted_free(ptr); }
+
+void operator delete[](void* ptr, size_t, align_val_t) noexcept
+{ counted_free(ptr); }
+
+void operator delete(void* ptr, align_val_t, const nothrow_t&) noexcept
+{ counted_free(ptr); }
+
+void operator delete[](void* ptr, align_val_t, const nothrow_t&) noexcept
+{ counted_free(ptr); }
+#endif
+
+/* nodes are told apart by their type alone */
+static_assert(! std::is_polymorphic<kwarg>::value, "kwarg has no vtable");
+static_assert(! std::is_polymorphic<config_section>::value, "nor has a section");
+static_assert(! std::is_polymorphic<config>::value, "nor has the root");
+static_assert(sizeof(kwarg_const) <= 3 * sizeof(void*), "a scalar node is three words");
+
+static void
+check(const config_handle::snapshot& cfg) {
+    /* the values of tst17-inc.cfg replace those of tst17.cfg */
+    const config_section* sec = cfg->section("section_1");
+    assert(1234 == sec->get<int>("integer_data"));
+    assert("a string" == sec->get<string>("string_data"));
+    assert(1.5 == sec->get<double>("floating_data"));
+    assert(true == sec->get<bool>("boolean_data"));
+
+    /* a value which is not a string reads as an empty one */
+    assert(sec->get<string>("integer_data").empty());
+
+    const kwarg_vector& vec = cfg->section("vectors")->vector("strings");
+    assert(3 == vec->size());
+    assert("b" == vec->at(1)->as<string>());
+    assert(2 == cfg->section("vectors")->vector("integers").span<int64_t>()[1]);
+
+    const kwarg_vector& sections = cfg->section("vectors")->vector("sections");
+    assert(2 == sections->size());
+    assert(kwarg::SECTION == sections->at(0)->type());
+    assert(kwarg::SECTION == sections->at(1)->type());
+}
+
+static void
+load(int flags) {
+    config_handle handle("test/tst17.cfg", flags);
+    check(handle.acquire());
+
+    /* a reload replaces, and the previous load frees, every node */
+    handle.reload();
+    check(handle.acquire());
+}
+
+/// an arena load builds the elements of a vector where they stay, never on the heap
+static void
+load_vectors() {
+    const string file = "/tmp/tst17-vectors.cfg";
+    const int ELEMENTS = 10000;
+
+    {
+        ofstream out(file);
+        out << "integers = [";
+
+        for (int i = 0; i < ELEMENTS; ++i)
+            out << " " << i << ",";
+
+        out << " ]\nmixed = [ \"a\",";
+
+        for (int i = 0; i < ELEMENTS; ++i)
+            out << " " << i << ",";
+
+        out << " ]\n";
+    }
+
+    const long before = made;
+    config cfg(file, config::LOAD_ARENA);
+    assert(made - before < ELEMENTS / 10);
+
+    assert(ELEMENTS - 1 == cfg.vector("integers").span<int64_t>()[ELEMENTS - 1]);
+    assert(kwarg::UNDEFINED == cfg.vector("mixed").value_type());
+    assert(ELEMENTS + 1 == cfg.vector("mixed")->size());
+    assert(ELEMENTS - 1 == cfg.vector("mixed")->back()->as<int64_t>());
+
+    remove(file.c_str());
+}
+
+int
+main() {
+    const int flags[] = { config::LOAD_DEFAULT
+                        , config::LOAD_ARENA
+                        , config::LOAD_MMAP | config::LOAD_ARENA
+                        , config::LOAD_CACHE_INCLUDES
+                        , config::LOAD_LAZY };
+
+    for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i) {
+        load(flags[i]);
+
+        /* the first load may leave behind what lives as long as the process; no other
+         * does, down to the children of the sections held in a vector */
+        const long before = live;
+        load(flags[i]);
+        assert(before == live);
+    }
+
+    load_vectors();
+
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "config.hh"
+#include "config-reload.hh"
+
+#include <cassert>
+#include <cstring>
+#include <string>
+
+
+using namespace std;
+
+static void
+check(const config_handle::snapshot& cfg) {
+    /* tst5.cfg */
+    const config_section* window = cfg->section("application")->section("window");
+    const char* title = window->get<const char*>("title");
+
+    assert(0 == strcmp("My Application", title));
+    assert(title == window->get<const char*>("title"));
+    assert(title == cfg->get_path<const char*>("application.window.title"));
+    assert(title == *cfg->key<const char*>("application.window.title"));
+    assert(title == window->get<const char*>("title", "fallback"));
+    assert(0 == strcmp("fallback", window->get<const char*>("missing", "fallback")));
+
+    /* a hot loop reads the same characters every time, without copying them */
+    for (size_t i = 0; i < 100000; ++i) {
+        assert(title == window->get<const char*>("title"));
+        assert(title == cfg->section("application")->section("window")
+                            ->get<const char*>("title"));
+    }
+
+    /* a value which is not a string reads as "" */
+    assert(0 == strcmp("", cfg->get_path<const char*>("application.word")));
+
+    const kwarg_vector& columns = cfg->section("application")->section("misc")
+                                     ->vector("columns");
+    assert(0 == strcmp("First Name", columns->at(1)->as<const char*>()));
+
+#if __cplusplus >= 201703L
+    const std::string_view view = window->get<std::string_view>("title");
+    assert(view == "My Application");
+    assert(view.data() == title);
+#endif
+}
+
+int
+main() {
+    const int flags[] = { config::LOAD_DEFAULT
+                        , config::LOAD_ARENA
+                        , config::LOAD_CACHE_INCLUDES
+                        , config::LOAD_LAZY };
+
+    for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i) {
+        config_handle handle("test/tst5.cfg", flags[i]);
+        const config_handle::snapshot before = handle.acquire();
+        const char* version = before->get<const char*>("version");
+        check(before);
+
+        /* the characters outlive a reload for as long as the snapshot holding them */
+        handle.reload();
+        check(handle.acquire());
+        assert(0 == strcmp("1.0", version));
+        assert(version == before->get<const char*>("version"));
+    }
+
+    return 0;
+}
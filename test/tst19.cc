@@ -0,0 +1,48 @@
+#include "config.hh"
+#include "config-reload.hh"
+
+#include <cassert>
+#include <string>
+
+
+using namespace std;
+
+static const config_section*
+element(const kwarg_vector& vec, size_t i) {
+    assert(kwarg::SECTION == vec->at(i)->type());
+    return reinterpret_cast<const config_section*>(vec->at(i));
+}
+
+static void
+check(const config_handle::snapshot& cfg) {
+    const kwarg_vector& a = cfg->vector("a");
+    assert(1 == a->size());
+    assert(2 == element(a, 0)->get<int>("y"));
+    assert(! element(a, 0)->has_kwarg("x"));
+
+    assert(1 == cfg->section("b")->get<int>("x"));
+    assert(2 == cfg->section("b")->get<int>("y"));
+
+    assert(3 == cfg->get<int>("c"));
+    assert(1 == cfg->section("d")->get<int>("x"));
+
+    const kwarg_vector& e = cfg->vector("e");
+    assert(2 == e->size());
+    assert(1 == element(e, 0)->get<int>("x"));
+    assert("two" == element(e, 1)->get<string>("y"));
+
+    assert(cfg->has_section("f"));
+    assert(! cfg->section("f")->has_kwarg("x"));
+}
+
+int
+main() {
+    const int flags[] = { config::LOAD_DEFAULT
+                        , config::LOAD_ARENA
+                        , config::LOAD_LAZY };
+
+    for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i)
+        check(config_handle("test/tst19.cfg", flags[i]).acquire());
+
+    return 0;
+}
@@ -0,0 +1,192 @@
+#include "config.hh"
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+
+/* more distinct paths than the path cache keeps records for */
+static const int SECTIONS = 80;
+static const int KEYS     = 80;
+
+/* more hot paths than the first level of the path cache has ways (64 sets of 4) */
+static const int HOT      = 512;
+
+/* elements of a packed vector, read by index */
+static const int TABLE    = 1000;
+
+static string
+path(int s, int k) {
+    return "s" + to_string(s) + ".k" + to_string(k);
+}
+
+static void
+check(const config& cfg, int pass) {
+    for (int s = 0; s < SECTIONS; ++s)
+        for (int k = 0; k < KEYS; ++k)
+            assert(s * KEYS + k == cfg.get_path<int>(path(s, k)));
+
+    /* a path which resolves to nothing is cached as such */
+    assert(! cfg.has_path("s0.missing"));
+    assert(-1 == cfg.get_path<int>("s" + to_string(SECTIONS) + ".k0", -1));
+
+    /* a few hot paths, read in turn, are found whichever sets they hash to */
+    for (int i = 0; i < 1000; ++i) {
+        const int s = (i + pass) % 8;
+        assert(s * KEYS == cfg.get_path<int>(path(s, 0)));
+    }
+
+    for (int i = pass; i < TABLE; i += 7) {
+        const string elem = "table[" + to_string(i) + "]";
+        assert(i + 0.5 == cfg.get_path<double>(elem));
+        assert(i + 0.5 == *cfg.key<double>(elem));
+    }
+}
+
+/// many hot paths, read in turn from every thread while the cache still grows
+static void
+check_hot(const config& cfg, int pass) {
+    for (int round = 0; round < 20; ++round)
+        for (int i = 0; i < HOT; ++i) {
+            const int n = (i * 7 + pass * 131 + round) % HOT;
+            const int s = SECTIONS - 1 - n / KEYS;
+            const int k = n % KEYS;
+            assert(s * KEYS + k == cfg.get_path<int>(path(s, k)));
+        }
+}
+
+template <typename _Tp>
+static bool
+throws_key_error(const config& cfg, const string& path) {
+    try {
+        cfg.get_path<_Tp>(path);
+    } catch (const config_key_error&) {
+        return true;
+    }
+
+    return false;
+}
+
+static void
+check_elements(const config& cfg) {
+    /* an index may be followed by more of the path */
+    assert(80 == cfg.get_path<int>("servers[0].port"));
+    assert(81 == cfg.get_path<int>("servers[1].port"));
+    assert("b" == cfg.get_path<string>("servers[1].hosts[1]"));
+    assert(81 == *cfg.key<int>("servers[1].port"));
+    assert(cfg.key<config_section>("servers[1]")->has_kwarg("hosts"));
+
+    assert(cfg.has_path("servers[0]"));
+    assert(! cfg.has_path("servers[0].missing"));
+    assert(! cfg.has_path("servers[2].port"));
+    assert(! cfg.has_path("servers[0]port"));
+    assert(! cfg.has_path("servers[1].port[0]"));
+    assert(! cfg.has_path("servers[1].hosts[0][0]"));
+    assert(! cfg.has_path("servers.port"));
+
+    /* a section or a vector is not a value */
+    assert(throws_key_error<long>(cfg, "servers[0]"));
+    assert(throws_key_error<long>(cfg, "servers"));
+    assert(throws_key_error<long>(cfg, "s0"));
+    assert(throws_key_error<string>(cfg, "servers[1].hosts"));
+
+    try {
+        cfg.get_path<long>("servers[0]", 1);
+        assert(false);
+    } catch (const config_key_error&) {
+    }
+
+    try {
+        cfg.key<long>("servers[1]");
+        assert(false);
+    } catch (const config_key_error&) {
+    }
+
+    /* indexing a packed vector builds the nodes of the elements read, not every node;
+     * the views built by -> afterwards are other nodes, of the same values */
+    const kwarg_vector& table = cfg.vector("table");
+    assert(kwarg::FLOATING == table.value_type());
+    assert(cfg.has_path("table[999]"));
+    assert(! cfg.has_path("table[1000]"));
+
+    const kwarg_const* elem = cfg.key<double>("table[3]").ptr();
+    assert(elem == table.at(3));
+    assert(elem != table->at(3));
+    assert(table->at(3)->as<double>() == elem->as<double>());
+    assert(table->at(3) == table.at(3));
+}
+
+/**
+ * Only one config can exist per process with CONFIG_SINGLETON, so each flag is loaded
+ * in a child process.
+ */
+static void
+load(const string& file, int flags) {
+    pid_t pid = fork();
+
+    if (0 == pid) {
+        config::initialize(file, flags);
+        vector<thread> readers;
+
+        for (int pass = 0; pass < 4; ++pass)
+            readers.push_back(thread(check_hot, std::cref(*CFG), pass));
+
+        for (auto it = readers.begin(); it != readers.end(); ++it)
+            it->join();
+
+        readers.clear();
+
+        for (int pass = 0; pass < 4; ++pass)
+            readers.push_back(thread(check, std::cref(*CFG), pass));
+
+        for (auto it = readers.begin(); it != readers.end(); ++it)
+            it->join();
+
+        check(*CFG, 0);
+        check_elements(*CFG);
+        _exit(0);
+    }
+
+    int status;
+    assert(pid == waitpid(pid, &status, 0));
+    assert(WIFEXITED(status) && 0 == WEXITSTATUS(status));
+}
+
+int
+main() {
+    const string file = "/tmp/tst20.cfg";
+
+    {
+        ofstream out(file);
+
+        for (int s = 0; s < SECTIONS; ++s) {
+            out << "s" << s << " = {\n";
+
+            for (int k = 0; k < KEYS; ++k)
+                out << "    k" << k << " = " << s * KEYS + k << "\n";
+
+            out << "}\n";
+        }
+
+        out << "servers = [ { port = 80 }, { port = 81; hosts = [ \"a\", \"b\" ] } ]\n";
+        out << "table = [";
+
+        for (int i = 0; i < TABLE; ++i)
+            out << (i ? ", " : " ") << i + 0.5;
+
+        out << " ]\n";
+    }
+
+    load(file, config::LOAD_DEFAULT);
+    load(file, config::LOAD_ARENA);
+
+    remove(file.c_str());
+    return 0;
+}
@@ -26,6 +26,15 @@ main() {
         DEBUG(e.what());
     }
 
+    /* a macro is not a value, in a vector or otherwise */
+    try {
+        config::initialize("test/tst3-macro.cfg");
+        return 1;
+    } catch (const config_parse_exception& e) {
+        DEBUG(e.what());
+        assert(string::npos != string(e.what()).find("unexpected macro in value"));
+    }
+
 
     return 0;
 }
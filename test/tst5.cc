@@ -0,0 +1,100 @@
+#include "config.hh"
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+
+using namespace std;
+
+/**
+ * Round trips test/tst5.cfg through a binary snapshot.  Only one config can exist per
+ * process with CONFIG_SINGLETON so the snapshot is compiled in a child process.
+ */
+int
+main() {
+    const string snapshot = "tst5.cfgc";
+
+    pid_t pid = fork();
+
+    if (0 == pid) {
+        config::initialize("test/tst5.cfg");
+        CFG->compile(snapshot);
+        _exit(0);
+    }
+
+    int status;
+    assert(pid == waitpid(pid, &status, 0));
+    assert(WIFEXITED(status) && 0 == WEXITSTATUS(status));
+
+    /* a truncated snapshot is rejected before anything is built */
+    {
+        ifstream in(snapshot, ios::binary);
+        string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        ofstream out(snapshot + ".bad", ios::binary);
+        out.write(data.data(), data.size() - 1);
+    }
+
+    try {
+        config::load_compiled(snapshot + ".bad");
+        return 1;
+    } catch (const config_parse_exception& e) {
+        cerr << e.what() << endl;
+    }
+
+    config::load_compiled(snapshot);
+    remove(snapshot.c_str());
+    remove((snapshot + ".bad").c_str());
+
+    assert(CFG->get<string>("version") == "1.0");
+    assert(CFG->get_path<string>("application.window.title") == "My Application");
+    assert(CFG->get_path<long>("application.window.size.w") == 640);
+    assert(CFG->get_path<long>("application.misc.bigint") == 9223372036854775807L);
+    assert(CFG->get_path<long>("application.misc.mask") == 0xFFFF);
+    assert(CFG->get_path<double>("application.misc.pi") == 3.141592654);
+    assert(CFG->get_path<bool>("application.misc.enabled"));
+    assert(CFG->get_path<string>("application.misc.columns[1]") == "First Name");
+    assert(CFG->get_path<long>("application.word") == 4);
+
+    /* a key resolves its path once */
+    auto width = CFG->key<int>("application.window.size.w");
+    assert(*width == 640);
+    assert(CFG->key<config_section>("application.window")->has_kwarg("title"));
+
+    const kwarg_vector& books = CFG->section("application")->vector("books");
+    assert(books->size() == 2);
+    assert(books->at(1)->type() == kwarg::SECTION);
+
+    const kwarg_vector& list = CFG->section("application")->vector("list");
+    assert(list->size() == 3);
+    assert(list->at(0)->as<long>() == 1);
+    assert(list->at(1)->as<double>() == 1.234);
+    assert(list->at(2)->as<string>() == "three");
+
+    /* definition order and packing survive */
+    auto it = CFG->section("application")->cbegin();
+    assert((*it)->name() == "window");
+    assert(CFG->section("application")->section("misc")->vector("columns").value_type()
+            == kwarg::UNDEFINED);
+
+    /* packed vectors are stored whole, and load as packed */
+    const config_section* misc = CFG->section("application")->section("misc");
+    const config_span<int64_t> ports = misc->vector("ports").span<int64_t>();
+    assert(3 == ports.size() && 80 == ports[0] && 8080 == ports[2]);
+
+    const config_span<double> ratios = misc->vector("ratios").span<double>();
+    assert(3 == ratios.size() && 1.0 == ratios[1] && 2.25 == ratios[2]);
+
+    const config_span<bool> flags = misc->vector("flags").span<bool>();
+    assert(3 == flags.size() && flags[0] && ! flags[1] && flags[2]);
+
+    assert(CFG->get_path<long>("application.misc.grid[1].row[0]") == 3);
+    assert((*CFG->key<kwarg_vector>("application.misc.grid[0].row")).value_type()
+            == kwarg::INTEGRAL);
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "config.hh"
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+
+using namespace std;
+
+/**
+ * A parallel load must be indistinguishable from a sequential one.  Each load is
+ * compiled to a snapshot, which is a deterministic serialization of the tree, and the
+ * bytes compared.  Only one config can exist per process with CONFIG_SINGLETON so every
+ * load runs in its own child.
+ */
+static string
+load(int flags, const string& snapshot) {
+    pid_t pid = fork();
+
+    if (0 == pid) {
+        config::initialize("test/tst6.cfg", flags);
+        CFG->compile(snapshot);
+        _exit(0);
+    }
+
+    int status;
+    assert(pid == waitpid(pid, &status, 0));
+    assert(WIFEXITED(status) && 0 == WEXITSTATUS(status));
+
+    ifstream in(snapshot, ios::binary);
+    string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    remove(snapshot.c_str());
+    return data;
+}
+
+int
+main() {
+    const string sequential = load(config::LOAD_DEFAULT, "tst6-0.cfgc");
+
+    assert(sequential.size() > 0);
+    assert(sequential == load(config::LOAD_PARALLEL, "tst6-1.cfgc"));
+    assert(sequential == load(config::LOAD_PARALLEL | config::LOAD_ARENA, "tst6-2.cfgc"));
+    assert(sequential == load(config::LOAD_PARALLEL | config::LOAD_MMAP, "tst6-3.cfgc"));
+
+    config::initialize("test/tst6.cfg", config::LOAD_PARALLEL);
+
+    assert(CFG->get<string>("greeting") == "hello");
+    assert(CFG->get<long>("x") == 10);
+    assert(CFG->get<long>("b_value") == 2);
+    assert(CFG->get_path<string>("service.name") == "root");
+    assert(CFG->get_path<long>("service.port") == 8080);
+    assert(CFG->get_path<long>("service.limits.cpu") == 1);
+    assert(CFG->get_path<long>("service.limits.mem") == 2);
+    assert(CFG->get_path<long>("y.z") == 1);
+    assert(! CFG->has_path("y.old"));
+    assert(CFG->get_path<long>("nested.x") == 1);
+    assert(CFG->get_path<long>("nested.service.port") == 8080);
+
+    return 0;
+}
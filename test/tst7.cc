@@ -0,0 +1,75 @@
+#include "config.hh"
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+
+using namespace std;
+
+/**
+ * Reusing a cached include must be indistinguishable from parsing it again.  As with
+ * tst6 each load is compiled to a snapshot in its own child and the bytes compared.
+ */
+static string
+load(int flags, const string& snapshot) {
+    pid_t pid = fork();
+
+    if (0 == pid) {
+        config::initialize("test/tst7.cfg", flags);
+        CFG->compile(snapshot);
+        _exit(0);
+    }
+
+    int status;
+    assert(pid == waitpid(pid, &status, 0));
+    assert(WIFEXITED(status) && 0 == WEXITSTATUS(status));
+
+    ifstream in(snapshot, ios::binary);
+    string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    remove(snapshot.c_str());
+    return data;
+}
+
+int
+main() {
+    const int cached = config::LOAD_CACHE_INCLUDES;
+    const string plain = load(config::LOAD_DEFAULT, "tst7-0.cfgc");
+
+    assert(plain.size() > 0);
+    assert(plain == load(cached, "tst7-1.cfgc"));
+    assert(plain == load(cached | config::LOAD_ARENA, "tst7-2.cfgc"));
+    assert(plain == load(cached | config::LOAD_PARALLEL, "tst7-3.cfgc"));
+    assert(plain == load(cached | config::LOAD_PARALLEL | config::LOAD_ARENA
+                       , "tst7-4.cfgc"));
+
+    config::initialize("test/tst7.cfg", cached | config::LOAD_ARENA);
+
+    assert(CFG->get_path<string>("first.name") == "one");
+    assert(CFG->get_path<string>("second.name") == "one");
+    assert(CFG->get_path<string>("third.name") == "two");
+    assert(CFG->get_path<string>("fourth.name") == "two");
+
+    /* first and second share one subtree until second is extended */
+    assert(CFG->section("first")->section("limits")
+        != CFG->section("second")->section("limits"));
+    assert(CFG->section("third")->section("limits")
+        == CFG->section("fourth")->section("limits"));
+    assert(CFG->get_path<long>("second.limits.cpu") == 1);
+    assert(CFG->get_path<long>("second.limits.mem") == 4);
+    assert(! CFG->has_path("first.limits.mem"));
+    assert(! CFG->has_path("fourth.limits.mem"));
+
+    assert(CFG->get_path<long>("fifth.count") == 1);
+    assert(CFG->get_path<long>("sixth.count") == 2);
+    assert(CFG->get<long>("total") == 2);
+    assert(CFG->get_path<long>("seventh.count") == 1);
+    assert(CFG->get<long>("next") == 2);
+
+    return 0;
+}
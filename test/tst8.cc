@@ -0,0 +1,98 @@
+#include "config.hh"
+#include "config-reload.hh"
+
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+
+static const char* CONFIG_PATH = "tst8.cfg";
+
+static void
+write_config(long value) {
+    ofstream out(CONFIG_PATH, ios::trunc);
+    out << "value  = " << value << endl
+        << "mirror = { value = " << value << " }" << endl;
+}
+
+/**
+ * Readers check that every snapshot they pin is internally consistent and that they
+ * never observe an older snapshot than one they have already seen, while the main thread
+ * reloads underneath them.
+ */
+static void
+run(int flags) {
+    write_config(0);
+    config_handle handle(CONFIG_PATH, flags);
+    const config_handle::snapshot pinned = handle.acquire();
+
+    assert(1 == handle.generation());
+
+    atomic<bool> stop(false);
+    vector<thread> readers;
+
+    for (int i = 0; i < 4; ++i) {
+        readers.push_back(thread([&handle, &stop]() {
+            long last = 0;
+
+            while (! stop.load()) {
+                config_handle::snapshot cfg = handle.acquire();
+                const long value = cfg->get<long>("value");
+
+                assert(value == cfg->get_path<long>("mirror.value"));
+                assert(value >= last);
+                last = value;
+            }
+        }));
+    }
+
+    for (long i = 1; i <= 50; ++i) {
+        write_config(i);
+        handle.reload();
+    }
+
+    stop.store(true);
+
+    for (auto it = readers.begin(); it != readers.end(); ++it)
+        it->join();
+
+    assert(51 == handle.generation());
+    assert(50 == handle.acquire()->get<long>("value"));
+
+    /* a pinned snapshot outlives every reload */
+    assert(0 == pinned->get<long>("value"));
+
+    /* a failed reload leaves the last good snapshot in place */
+    {
+        ofstream out(CONFIG_PATH, ios::trunc);
+        out << "value = 1x2" << endl;
+    }
+
+    bool threw = false;
+
+    try {
+        handle.reload();
+    } catch (const config_parse_exception&) {
+        threw = true;
+    }
+
+    assert(threw);
+    assert(51 == handle.generation());
+    assert(50 == handle.acquire()->get<long>("value"));
+}
+
+int
+main() {
+    run(config::LOAD_DEFAULT);
+    run(config::LOAD_ARENA | config::LOAD_MMAP);
+
+    remove(CONFIG_PATH);
+    return 0;
+}
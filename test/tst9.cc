@@ -0,0 +1,164 @@
+#include "config.hh"
+#include "config-reload.hh"
+#include "config-watch.hh"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+
+
+using namespace std;
+
+static const string DIR = "tst9.d";
+
+static void
+write_file(const string& name, const string& text) {
+    /* written beside the target and renamed over it, as most editors do */
+    const string path = DIR + "/" + name;
+    {
+        ofstream out(path + ".tmp", ios::trunc);
+        out << text;
+    }
+    assert(0 == rename((path + ".tmp").c_str(), path.c_str()));
+}
+
+static bool
+wait_for(function<bool()> done) {
+    for (int i = 0; i < 500; ++i) {
+        if (done())
+            return true;
+
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+
+    return false;
+}
+
+static bool
+ends_with(const string& str, const string& suffix) {
+    return str.size() >= suffix.size()
+        && 0 == str.compare(str.size() - suffix.size(), suffix.size(), suffix);
+}
+
+int
+main() {
+    mkdir(DIR.c_str(), 0755);
+    write_file("root.cfg", "@include  \"$DOT/a.cfg\"\n"
+                           "@include* \"$DOT/missing.cfg\"\n"
+                           "@include* \"$DOT/sub/deeper/optional.cfg\"\n"
+                           "name = \"root\"\n");
+    write_file("a.cfg", "value = 1\n");
+
+    config_handle handle(DIR + "/root.cfg");
+
+    /* every file the load touched, including the optional one which does not exist */
+    {
+        const vector<config_source>& sources = handle.acquire()->sources();
+        assert(4 == sources.size());
+        assert(ends_with(sources[0].path, "/tst9.d/a.cfg")       && sources[0].present);
+        assert(ends_with(sources[1].path, "/tst9.d/missing.cfg") && ! sources[1].present);
+        assert(ends_with(sources[2].path, "/tst9.d/root.cfg")    && sources[2].present);
+        assert(ends_with(sources[3].path, "/tst9.d/sub/deeper/optional.cfg")
+            && ! sources[3].present);
+    }
+
+    config_watcher watcher(handle, 20);
+
+    /* the same bytes saved again are not a change */
+    write_file("a.cfg", "value = 1\n");
+    this_thread::sleep_for(chrono::milliseconds(300));
+    assert(1 == handle.generation());
+    assert(0 == watcher.reloads());
+
+    write_file("a.cfg", "value = 2\n");
+    assert(wait_for([&]() { return 2 == handle.generation(); }));
+    assert(2 == handle.acquire()->get<long>("value"));
+
+    /* an optional include which appears */
+    write_file("missing.cfg", "extra = 3\n");
+    assert(wait_for([&]() { return 3 == handle.generation(); }));
+    assert(3 == handle.acquire()->get<long>("extra"));
+
+    /* a broken save keeps the last good snapshot */
+    write_file("a.cfg", "value = 1x2\n");
+    assert(wait_for([&]() { return 1 == watcher.failures(); }));
+    assert(3 == handle.generation());
+    assert(2 == handle.acquire()->get<long>("value"));
+    assert(! watcher.last_error().empty());
+
+    write_file("a.cfg", "value = 4\n");
+    assert(wait_for([&]() { return 4 == handle.generation(); }));
+    assert(4 == handle.acquire()->get<long>("value"));
+    assert(wait_for([&]() { return 3 == watcher.reloads(); }));
+
+    /* an optional include in directories which do not exist yet */
+    assert(0 == mkdir((DIR + "/sub").c_str(), 0755));
+    this_thread::sleep_for(chrono::milliseconds(50));
+    assert(0 == mkdir((DIR + "/sub/deeper").c_str(), 0755));
+    write_file("sub/deeper/optional.cfg", "deep = 5\n");
+    assert(wait_for([&]() { return 5 == handle.generation(); }));
+    assert(5 == handle.acquire()->get<long>("deep"));
+    assert(wait_for([&]() { return 4 == watcher.reloads(); }));
+
+    /* a directory above a watched one which is replaced, as a deploy would */
+    assert(0 == mkdir((DIR + "/sub.new").c_str(), 0755));
+    assert(0 == mkdir((DIR + "/sub.new/deeper").c_str(), 0755));
+    write_file("sub.new/deeper/optional.cfg", "deep = 6\n");
+    assert(0 == rename((DIR + "/sub").c_str(), (DIR + "/sub.old").c_str()));
+    assert(0 == rename((DIR + "/sub.new").c_str(), (DIR + "/sub").c_str()));
+    assert(wait_for([&]() { return 6 == handle.acquire()->get<long>("deep"); }));
+
+    /* a required include in a directory of its own */
+    assert(0 == mkdir((DIR + "/conf").c_str(), 0755));
+    write_file("conf/b.cfg", "b = 1\n");
+    write_file("root.cfg", "@include  \"$DOT/a.cfg\"\n"
+                           "@include* \"$DOT/missing.cfg\"\n"
+                           "@include* \"$DOT/sub/deeper/optional.cfg\"\n"
+                           "@include  \"$DOT/conf/b.cfg\"\n"
+                           "name = \"root\"\n");
+    assert(wait_for([&]() { return 1 == handle.acquire()->get<long>("b", 0L); }));
+
+    /* the directory itself replaced; the watch would follow the old one */
+    assert(0 == mkdir((DIR + "/conf.new").c_str(), 0755));
+    write_file("conf.new/b.cfg", "b = 2\n");
+    assert(0 == rename((DIR + "/conf").c_str(), (DIR + "/conf.old").c_str()));
+    assert(0 == rename((DIR + "/conf.new").c_str(), (DIR + "/conf").c_str()));
+    assert(wait_for([&]() { return 2 == handle.acquire()->get<long>("b"); }));
+
+    write_file("conf/b.cfg", "b = 3\n");
+    assert(wait_for([&]() { return 3 == handle.acquire()->get<long>("b"); }));
+
+    /* removed, which fails the reload, then created again */
+    const uint64_t failures = watcher.failures();
+    assert(0 == remove((DIR + "/conf/b.cfg").c_str()));
+    assert(0 == rmdir((DIR + "/conf").c_str()));
+    assert(wait_for([&]() { return failures < watcher.failures(); }));
+    assert(3 == handle.acquire()->get<long>("b"));
+
+    assert(0 == mkdir((DIR + "/conf").c_str(), 0755));
+    write_file("conf/b.cfg", "b = 4\n");
+    assert(wait_for([&]() { return 4 == handle.acquire()->get<long>("b"); }));
+
+    remove((DIR + "/conf/b.cfg").c_str());
+    rmdir((DIR + "/conf").c_str());
+    remove((DIR + "/conf.old/b.cfg").c_str());
+    rmdir((DIR + "/conf.old").c_str());
+    remove((DIR + "/sub.old/deeper/optional.cfg").c_str());
+    rmdir((DIR + "/sub.old/deeper").c_str());
+    rmdir((DIR + "/sub.old").c_str());
+    remove((DIR + "/sub/deeper/optional.cfg").c_str());
+    rmdir((DIR + "/sub/deeper").c_str());
+    rmdir((DIR + "/sub").c_str());
+    remove((DIR + "/root.cfg").c_str());
+    remove((DIR + "/a.cfg").c_str());
+    remove((DIR + "/missing.cfg").c_str());
+    rmdir(DIR.c_str());
+    return 0;
+}
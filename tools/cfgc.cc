@@ -0,0 +1,40 @@
+/**
+ * @file cfgc.cc
+ *
+ * Compiles a config file (and everything it includes) into a binary snapshot which can
+ * be loaded with config::load_compiled or config::LOAD_COMPILED.
+ *
+ * usage: cfgc <input.cfg> <output>
+ *
+ * Macros imported from the environment are resolved at compile time, so the snapshot
+ * reflects the environment of the compiler and not that of the process loading it.
+ */
+#include "config.hh"
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+
+int
+main(int argc, char* argv[]) {
+    if (3 != argc) {
+        std::cerr << "usage: " << argv[0] << " <input.cfg> <output>" << std::endl;
+        return 2;
+    }
+
+    try {
+#if defined(CONFIG_SINGLETON)
+        config* cfg = config::initialize(argv[1], config::LOAD_MMAP | config::LOAD_ARENA);
+#else
+        std::unique_ptr<config> cfg(
+                new config(argv[1], config::LOAD_MMAP | config::LOAD_ARENA));
+#endif
+        cfg->compile(argv[2]);
+    } catch (const std::exception& e) {
+        std::cerr << argv[1] << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}